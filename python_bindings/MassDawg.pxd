@@ -1,11 +1,73 @@
 from libcpp.vector cimport vector
 from libcpp.string cimport string
 
-cdef extern from "../src/MassDawg.hpp":
+# every call is made without the GIL, so the masses are passed as 
+# pointers into numpy buffers instead of python lists
+cdef extern from "../src/ScoredKmer.hpp" nogil:
+    cdef cppclass ScoredKmer:
+        string kmer
+        float score
+
+cdef extern from "../src/MassDawg.hpp" nogil:
+    cdef cppclass MassDawgStats:
+        int nodes
+        int edges
+        int kmers
+        int deadKmers
+        size_t nodeBytes
+        size_t kmerIdBytes
+        size_t childrenBytes
+        size_t kmerTableBytes
+        size_t minimizedNodesBytes
+        vector[int] fanoutHistogram
+        vector[int] depthHistogram
+        double mergeRatio
+        size_t totalBytes()
+
     cdef cppclass MassDawg: 
         MassDawg() except +
         void show()
         void insert(vector[float], vector[float], string) except +
+        void insert(const float *, const float *, int, string) except +
+        bint remove(const float *, const float *, int, string) except +
         vector[string] fuzzySearch(vector[float], int, int)
+        vector[string] fuzzySearch(const float *, int, int, int)
+        vector[string] memoizedFuzzySearch(const float *, int, int, int)
         vector[string] search(vector[float], int)
-        void finish()
\ No newline at end of file
+        vector[string] search(const float *, int, int)
+        vector[ScoredKmer] topKSearch(const float *, const float *, int, int, int, int) except +
+        void finish()
+        MassDawgStats stats()
+
+cdef extern from "../src/FastaDigester.hpp" nogil:
+    cdef cppclass FastaDigester:
+        FastaDigester(int, int) except +
+        int digestFile(string, MassDawg *) except +
+        int undigestFile(string, MassDawg *) except +
+
+cdef extern from "../src/FrozenMassDawg.hpp" nogil:
+    cdef cppclass FrozenMassDawg:
+        FrozenMassDawg(MassDawg *) except +
+        vector[string] fuzzySearch(vector[float], int, int)
+        vector[string] fuzzySearch(const float *, int, int, int)
+        vector[string] memoizedFuzzySearch(const float *, int, int, int)
+        vector[string] search(vector[float], int)
+        vector[string] search(const float *, int, int)
+        vector[ScoredKmer] topKSearch(const float *, const float *, int, int, int, int) except +
+        void bindTolerance(int)
+        int boundTolerance()
+        int nodeCount()
+        int edgeCount()
+        int kmerCount()
+        void save(string) except +
+        @staticmethod
+        FrozenMassDawg * load(string) except +
+
+cdef extern from "../src/BidirectionalMassDawg.hpp" nogil:
+    cdef cppclass BidirectionalMassDawg:
+        BidirectionalMassDawg() except +
+        void insert(string) except +
+        bint remove(string) except +
+        vector[string] fuzzySearch(const float *, int, int, int)
+        vector[string] search(const float *, int, int)
+        void finish()
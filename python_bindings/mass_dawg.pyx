@@ -1,10 +1,29 @@
 # distutils: language = c++
-# distutils: sources = ../src/MassDawg.cpp ../src/utils.cpp ../src/MassDawgNode.cpp
+# distutils: sources = ../src/MassDawg.cpp ../src/utils.cpp ../src/MassDawgNode.cpp ../src/MassDawgNodeArena.cpp ../src/KmerTable.cpp ../src/MinimizedNodeMap.cpp ../src/FrozenMassDawg.cpp ../src/FastaDigester.cpp ../src/BidirectionalMassDawg.cpp
 
 from libcpp.string cimport string 
 from libcpp.vector cimport vector
+cimport cython
 
-from MassDawg cimport MassDawg
+from MassDawg cimport MassDawg, MassDawgStats, ScoredKmer, FastaDigester, FrozenMassDawg, BidirectionalMassDawg
+
+import numpy as np
+
+cdef const float[::1] as_masses(sequence):
+    '''
+    View a sequence of masses as contiguous float32. Contiguous float32 numpy arrays 
+    are used as is, anything else (lists, float64 arrays) is converted once
+    '''
+    return np.ascontiguousarray(sequence, dtype=np.float32)
+
+@cython.boundscheck(False)
+cdef inline const float * first_mass(const float[::1] masses) nogil:
+    # an empty view has no first element to take the address of
+    return &masses[0] if masses.shape[0] > 0 else NULL
+
+cdef list scored_kmers(vector[ScoredKmer] & results):
+    # (kmer, score) tuples, best score first as they come from the search
+    return [(result.kmer.decode(), result.score) for result in results]
 
 # Create a Cython extension type which holds a C++ instance
 # as an attribute and create a bunch of forwarding methods
@@ -24,68 +43,482 @@ cdef class PyMassDawg:
         '''
         self.m_dawg.show()
 
-    def insert(self, singly_sequence: list, doubly_sequence: list, kmer: str) -> None:
+    def insert(self, singly_sequence, doubly_sequence, kmer: str) -> None:
         '''
         Insert a singly and doubly sequence into the graph associated with a kmer
 
         Inputs:
-            singly_sequence:    (list) singly charged masses (floats) to add to the graph
-            doubly_sequence:    (list) doubly charged masses (floats) to add to the graph
+            singly_sequence:    (list or np.ndarray) singly charged masses (floats) to add to the graph
+            doubly_sequence:    (list or np.ndarray) doubly charged masses (floats) to add to the graph
             kmer:               (str) the kmer associated with these masses
         Outputs:
             None
+        Raises:
+            ValueError if the sequences and kmer are not all the same non zero length or a mass is not a
+            number in the range of a fixed point mass
+        '''
+        cdef const float[::1] singly = as_masses(singly_sequence)
+        cdef const float[::1] doubly = as_masses(doubly_sequence)
+        cdef int length = <int>singly.shape[0]
+
+        cdef string input_kmer = str.encode(kmer)
+
+        # out of order insertions are merged like any other, so the only errors
+        # are bad input and they are raised to the caller
+        if doubly.shape[0] != length:
+            raise ValueError('singly_sequence and doubly_sequence must be the same length')
+
+        with nogil:
+            self.m_dawg.insert(first_mass(singly), first_mass(doubly), length, input_kmer)
+
+    def insert_fasta(self, fasta_file: str, max_length: int, chunk_size: int = 100000) -> int:
+        '''
+        Insert the kmers starting at every position of every protein in a FASTA file. The 
+        singly and doubly charged b ion masses are computed for each kmer, and kmers are 
+        sorted by mass in chunks of chunk_size before they are inserted
+
+        Inputs:
+            fasta_file:     (str) the path to the FASTA file
+            max_length:     (int) the longest kmer to insert from each position
+            chunk_size:     (int) the number of kmers to sort at a time. Default=100000
+        Outputs:
+            (int) the number of kmers inserted
         '''
-        cdef vector[float] singly_vec = singly_sequence
-        cdef vector[float] doubly_vec = doubly_sequence
+        cdef FastaDigester * digester = new FastaDigester(max_length, chunk_size)
+        cdef string path = str.encode(fasta_file)
+        cdef int inserted
 
+        try:
+            with nogil:
+                inserted = digester.digestFile(path, self.m_dawg)
+            return inserted
+        finally:
+            del digester
+
+    def remove(self, singly_sequence, doubly_sequence, kmer: str) -> bool:
+        '''
+        Remove one insertion of a kmer with the singly and doubly sequence it was inserted 
+        with. A kmer inserted more than once stays until it is removed as many times, and 
+        nodes nothing else reaches are pruned
+
+        Inputs:
+            singly_sequence:    (list or np.ndarray) singly charged masses (floats) the kmer was inserted with
+            doubly_sequence:    (list or np.ndarray) doubly charged masses (floats) the kmer was inserted with
+            kmer:               (str) the kmer to remove
+        Outputs:
+            (bool) True if the kmer was in the graph with these masses and was removed
+        '''
+        cdef const float[::1] singly = as_masses(singly_sequence)
+        cdef const float[::1] doubly = as_masses(doubly_sequence)
+        cdef int length = <int>singly.shape[0]
         cdef string input_kmer = str.encode(kmer)
+        cdef bint removed
+
+        if doubly.shape[0] != length:
+            raise ValueError('singly_sequence and doubly_sequence must be the same length')
+
+        with nogil:
+            removed = self.m_dawg.remove(first_mass(singly), first_mass(doubly), length, input_kmer)
+        return removed
+
+    def remove_fasta(self, fasta_file: str, max_length: int) -> int:
+        '''
+        Remove the kmers of every protein in a FASTA file that insert_fasta inserted with 
+        the same max_length, such as a set of decoys. Kmers other proteins still have stay
+
+        Inputs:
+            fasta_file:     (str) the path to the FASTA file
+            max_length:     (int) the max_length the file was inserted with
+        Outputs:
+            (int) the number of kmers removed
+        '''
+        cdef FastaDigester * digester = new FastaDigester(max_length, 1)
+        cdef string path = str.encode(fasta_file)
+        cdef int removed
 
         try:
-            self.m_dawg.insert(singly_vec, doubly_vec, input_kmer)
-        except:
-            print("ERROR: Items must be sorted smallest to largest for insertion")
+            with nogil:
+                removed = digester.undigestFile(path, self.m_dawg)
+            return removed
+        finally:
+            del digester
 
-    def fuzzy_search(self, search_sequence: list, gap_allowance: int, ppm_tol: int) -> list:
+    def fuzzy_search(self, search_sequence, gap_allowance: int, ppm_tol: int, memoize: bool = False) -> list:
         '''
         Search for a sequence in the graph allowing for up to gap_allowance missed masses in the search
 
         Inputs:
-            search_sequence:    (list) the sequence of masses (floats) to search for
+            search_sequence:    (list or np.ndarray) the sequence of masses (floats) to search for
             gap_allowance:      (int) the number of gaps allowed in the search
             ppm_tol:            (int) the allowed difference (in parts per million) allowed 
                                       between an observed and theoretical mass to be called a match
+            memoize:            (bool) reuse the results of a node reached again with the same masses 
+                                       left and gaps used. Same results, faster on merged graphs
         Outputs:
             (list) kmers (strings) found in the recursive search
         '''
-        cdef vector[float] search_seq_vec = search_sequence
+        cdef const float[::1] masses = as_masses(search_sequence)
+        cdef int gaps = gap_allowance, ppm = ppm_tol
+        cdef bint memo = memoize
+        cdef vector[string] results
 
-        cdef vector[string] results = self.m_dawg.fuzzySearch(search_seq_vec, gap_allowance, ppm_tol)
+        with nogil:
+            if memo:
+                results = self.m_dawg.memoizedFuzzySearch(first_mass(masses), <int>masses.shape[0], gaps, ppm)
+            else:
+                results = self.m_dawg.fuzzySearch(first_mass(masses), <int>masses.shape[0], gaps, ppm)
 
         return list(set(
             [result.decode() for result in results]
         ))
 
-    def search(self, search_sequence: list, ppm_tol: int) -> list:
+    def search(self, search_sequence, ppm_tol: int) -> list:
         '''
         Search for a sequence in the graph with no gaps allowed
 
         Inputs:
-            search_sequence:    (list) the sequence of masses (floats) to search for
+            search_sequence:    (list or np.ndarray) the sequence of masses (floats) to search for
             ppm_tol:            (int) the allowed difference (in parts per million) allowed 
                                       between an observed and theoretical mass to be called a match
         Outputs:
             (list) kmers (strings) found in the search
         '''
-        cdef vector[float] search_seq_vec = search_sequence
-        
-        cdef vector[string] results = self.m_dawg.search(search_seq_vec, ppm_tol)
-        
+        cdef const float[::1] masses = as_masses(search_sequence)
+        cdef int ppm = ppm_tol
+        cdef vector[string] results
+
+        with nogil:
+            results = self.m_dawg.search(first_mass(masses), <int>masses.shape[0], ppm)
+
         return list(set(
             [result.decode() for result in results]
         ))
 
+    def top_k_search(self, search_sequence, k: int, gap_allowance: int, ppm_tol: int, intensities=None) -> list:
+        '''
+        Search like fuzzy_search, but score each path by the masses it matches (or the sum of
+        their intensities) and return only the k best kmers. Branches that can not beat the
+        kth best kmer are not searched
+
+        Inputs:
+            search_sequence:    (list or np.ndarray) the sequence of masses (floats) to search for
+            k:                  (int) the number of kmers to return
+            gap_allowance:      (int) the number of gaps allowed in the search
+            ppm_tol:            (int) the allowed difference (in parts per million) allowed 
+                                      between an observed and theoretical mass to be called a match
+            intensities:        (list or np.ndarray) the intensity of each mass. If None, matched masses are counted
+        Outputs:
+            (list) (kmer, score) tuples, best score first
+        '''
+        cdef const float[::1] masses = as_masses(search_sequence)
+        cdef const float[::1] weights = as_masses(intensities if intensities is not None else [])
+        cdef const float * weight_ptr = NULL
+        cdef int top = k, gaps = gap_allowance, ppm = ppm_tol
+        cdef vector[ScoredKmer] results
+
+        if intensities is not None:
+            if weights.shape[0] != masses.shape[0]:
+                raise ValueError('intensities must be the same length as search_sequence')
+            weight_ptr = first_mass(weights)
+
+        with nogil:
+            results = self.m_dawg.topKSearch(first_mass(masses), weight_ptr, <int>masses.shape[0], top, gaps, ppm)
+
+        return scored_kmers(results)
+
     def finish(self):
         '''
         Final compression of any leftover nodes
         '''
-        self.m_dawg.finish()
\ No newline at end of file
+        with nogil:
+            self.m_dawg.finish()
+
+    def stats(self) -> dict:
+        '''
+        Measure the size and shape of the graph
+
+        Outputs:
+            (dict) with the keys
+                nodes:                  (int) nodes reachable from the root, including the root
+                edges:                  (int) edges between those nodes
+                kmers:                  (int) distinct kmers and prefixes of kmers
+                dead_kmers:             (int) removed kmers still taking up room in the kmer table
+                bytes:                  (dict) bytes used by 'nodes', 'kmer_ids', 'children', 
+                                        'kmer_strings', 'minimized_nodes' and 'total'
+                fanout_histogram:       (list) entry i is the number of nodes with i children
+                depth_histogram:        (list) entry d is the number of nodes whose shortest path 
+                                        from the root has d edges
+                merge_ratio:            (float) nodes a trie of the same kmers would have per node
+        '''
+        cdef MassDawgStats stats
+
+        with nogil:
+            stats = self.m_dawg.stats()
+
+        return {
+            'nodes': stats.nodes,
+            'edges': stats.edges,
+            'kmers': stats.kmers,
+            'dead_kmers': stats.deadKmers,
+            'bytes': {
+                'nodes': stats.nodeBytes,
+                'kmer_ids': stats.kmerIdBytes,
+                'children': stats.childrenBytes,
+                'kmer_strings': stats.kmerTableBytes,
+                'minimized_nodes': stats.minimizedNodesBytes,
+                'total': stats.totalBytes()
+            },
+            'fanout_histogram': list(stats.fanoutHistogram),
+            'depth_histogram': list(stats.depthHistogram),
+            'merge_ratio': stats.mergeRatio
+        }
+
+
+# A finished graph compiled into flat arrays, which can be saved to a file
+# and loaded again without rebuilding it
+cdef class PyFrozenMassDawg:
+    cdef FrozenMassDawg * m_frozen    # holds the c++ instance that is wrapped
+
+    def __cinit__(self, PyMassDawg dawg = None):
+        '''
+        Finish dawg and compile it into a frozen graph. The frozen graph no longer
+        needs dawg once it is made. Use PyFrozenMassDawg.load to load a saved graph instead
+
+        Inputs:
+            dawg:   (PyMassDawg) the graph to freeze
+        '''
+        self.m_frozen = NULL
+        if dawg is not None:
+            self.m_frozen = new FrozenMassDawg(dawg.m_dawg)
+
+    def __dealloc__(self):
+        del self.m_frozen
+
+    @staticmethod
+    def load(path: str) -> PyFrozenMassDawg:
+        '''
+        Map a graph written by save. The graph is searched straight from the file
+
+        Inputs:
+            path:   (str) the file to load
+        Outputs:
+            (PyFrozenMassDawg) the loaded graph
+        Raises:
+            RuntimeError if the file is not a saved graph, is corrupt or was saved by a module built
+            with a different MASSDAWG_CHARGES, which the message names
+        '''
+        cdef PyFrozenMassDawg frozen = PyFrozenMassDawg()
+        frozen.m_frozen = FrozenMassDawg.load(str.encode(path))
+        return frozen
+
+    def save(self, path: str) -> None:
+        '''
+        Write the graph to a file that can be loaded with PyFrozenMassDawg.load
+
+        Inputs:
+            path:   (str) where to write the graph
+        Outputs:
+            None
+        '''
+        self._check()
+        self.m_frozen.save(str.encode(path))
+
+    def bind_tolerance(self, ppm_tol: int) -> None:
+        '''
+        Precompute the tolerance windows of every node for one ppm tolerance. Searches with 
+        that tolerance use them instead of computing them, other tolerances work as before. 
+        Do not call this while other threads search the graph
+
+        Inputs:
+            ppm_tol:    (int) the tolerance to precompute, or a negative number to drop the windows
+        Outputs:
+            None
+        '''
+        self._check()
+        self.m_frozen.bindTolerance(ppm_tol)
+
+    def bound_tolerance(self) -> int:
+        '''
+        The tolerance set by bind_tolerance, or -1 if there is none
+        '''
+        self._check()
+        return self.m_frozen.boundTolerance()
+
+    def fuzzy_search(self, search_sequence, gap_allowance: int, ppm_tol: int, memoize: bool = False) -> list:
+        '''
+        Search for a sequence in the graph allowing for up to gap_allowance missed masses in the search
+
+        Inputs:
+            search_sequence:    (list or np.ndarray) the sequence of masses (floats) to search for
+            gap_allowance:      (int) the number of gaps allowed in the search
+            ppm_tol:            (int) the allowed difference (in parts per million) allowed 
+                                      between an observed and theoretical mass to be called a match
+            memoize:            (bool) reuse the results of a node reached again with the same masses 
+                                       left and gaps used. Same results, faster on merged graphs
+        Outputs:
+            (list) kmers (strings) found in the search
+        '''
+        self._check()
+        cdef const float[::1] masses = as_masses(search_sequence)
+        cdef int gaps = gap_allowance, ppm = ppm_tol
+        cdef bint memo = memoize
+        cdef vector[string] results
+
+        with nogil:
+            if memo:
+                results = self.m_frozen.memoizedFuzzySearch(first_mass(masses), <int>masses.shape[0], gaps, ppm)
+            else:
+                results = self.m_frozen.fuzzySearch(first_mass(masses), <int>masses.shape[0], gaps, ppm)
+
+        return list(set(
+            [result.decode() for result in results]
+        ))
+
+    def search(self, search_sequence, ppm_tol: int) -> list:
+        '''
+        Search for a sequence in the graph with no gaps allowed
+
+        Inputs:
+            search_sequence:    (list or np.ndarray) the sequence of masses (floats) to search for
+            ppm_tol:            (int) the allowed difference (in parts per million) allowed 
+                                      between an observed and theoretical mass to be called a match
+        Outputs:
+            (list) kmers (strings) found in the search
+        '''
+        self._check()
+        cdef const float[::1] masses = as_masses(search_sequence)
+        cdef int ppm = ppm_tol
+        cdef vector[string] results
+
+        with nogil:
+            results = self.m_frozen.search(first_mass(masses), <int>masses.shape[0], ppm)
+
+        return list(set(
+            [result.decode() for result in results]
+        ))
+
+    def top_k_search(self, search_sequence, k: int, gap_allowance: int, ppm_tol: int, intensities=None) -> list:
+        '''
+        Search like fuzzy_search, but score each path by the masses it matches (or the sum of
+        their intensities) and return only the k best kmers. Branches that can not beat the
+        kth best kmer are not searched
+
+        Inputs:
+            search_sequence:    (list or np.ndarray) the sequence of masses (floats) to search for
+            k:                  (int) the number of kmers to return
+            gap_allowance:      (int) the number of gaps allowed in the search
+            ppm_tol:            (int) the allowed difference (in parts per million) allowed 
+                                      between an observed and theoretical mass to be called a match
+            intensities:        (list or np.ndarray) the intensity of each mass. If None, matched masses are counted
+        Outputs:
+            (list) (kmer, score) tuples, best score first
+        '''
+        self._check()
+        cdef const float[::1] masses = as_masses(search_sequence)
+        cdef const float[::1] weights = as_masses(intensities if intensities is not None else [])
+        cdef const float * weight_ptr = NULL
+        cdef int top = k, gaps = gap_allowance, ppm = ppm_tol
+        cdef vector[ScoredKmer] results
+
+        if intensities is not None:
+            if weights.shape[0] != masses.shape[0]:
+                raise ValueError('intensities must be the same length as search_sequence')
+            weight_ptr = first_mass(weights)
+
+        with nogil:
+            results = self.m_frozen.topKSearch(first_mass(masses), weight_ptr, <int>masses.shape[0], top, gaps, ppm)
+
+        return scored_kmers(results)
+
+    def _check(self):
+        if self.m_frozen == NULL:
+            raise ValueError('the graph is empty, freeze a PyMassDawg or load a saved graph')
+
+cdef class PyBidirectionalMassDawg:
+    cdef BidirectionalMassDawg * m_dawg    # holds the c++ instance that is wrapped
+
+    def __cinit__(self):
+        self.m_dawg = new BidirectionalMassDawg()
+
+    def __dealloc__(self):
+        del self.m_dawg
+
+    def insert(self, kmer: str) -> None:
+        '''
+        Insert a kmer with its b ions into one graph and its y ions into the other. 
+        The masses are computed in C++
+
+        Inputs:
+            kmer:       (str) the amino acids of the kmer
+        Outputs:
+            None
+        '''
+        cdef string input_kmer = str.encode(kmer)
+
+        with nogil:
+            self.m_dawg.insert(input_kmer)
+
+    def remove(self, kmer: str) -> bool:
+        '''
+        Remove one insertion of a kmer from both graphs
+
+        Inputs:
+            kmer:       (str) the amino acids of the kmer
+        Outputs:
+            (bool) True if the kmer was in the graphs and was removed
+        '''
+        cdef string input_kmer = str.encode(kmer)
+        cdef bint removed
+
+        with nogil:
+            removed = self.m_dawg.remove(input_kmer)
+        return removed
+
+    def fuzzy_search(self, search_sequence, gap_allowance: int, ppm_tol: int) -> list:
+        '''
+        Search the b ion graph for prefixes and the y ion graph for suffixes, allowing for up
+        to gap_allowance missed masses in each, and keep the kmers a prefix and a suffix cover
+
+        Inputs:
+            search_sequence:    (list or np.ndarray) the sequence of masses (floats) to search for
+            gap_allowance:      (int) the number of gaps allowed in the search of each graph
+            ppm_tol:            (int) the allowed difference (in parts per million) allowed 
+                                      between an observed and theoretical mass to be called a match
+        Outputs:
+            (list) kmers (strings) found by both searches, sorted
+        '''
+        cdef const float[::1] masses = as_masses(search_sequence)
+        cdef int gaps = gap_allowance, ppm = ppm_tol
+        cdef vector[string] results
+
+        with nogil:
+            results = self.m_dawg.fuzzySearch(first_mass(masses), <int>masses.shape[0], gaps, ppm)
+
+        return [result.decode() for result in results]
+
+    def search(self, search_sequence, ppm_tol: int) -> list:
+        '''
+        Search like fuzzy_search with no gaps allowed
+
+        Inputs:
+            search_sequence:    (list or np.ndarray) the sequence of masses (floats) to search for
+            ppm_tol:            (int) the allowed difference (in parts per million) allowed 
+                                      between an observed and theoretical mass to be called a match
+        Outputs:
+            (list) kmers (strings) found by both searches, sorted
+        '''
+        cdef const float[::1] masses = as_masses(search_sequence)
+        cdef int ppm = ppm_tol
+        cdef vector[string] results
+
+        with nogil:
+            results = self.m_dawg.search(first_mass(masses), <int>masses.shape[0], ppm)
+
+        return [result.decode() for result in results]
+
+    def finish(self):
+        '''
+        Final compression of any leftover nodes in both graphs
+        '''
+        with nogil:
+            self.m_dawg.finish()
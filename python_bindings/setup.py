@@ -7,6 +7,14 @@ os.environ["CC"] = "g++"
 with open("README.md", "r") as fh:
     long_description = fh.read()
 
+# build options of the C++ library (see the main README) are taken from the environment,
+# e.g. MASSDAWG_CHARGES=3 MASSDAWG_SEARCH_STATS=1 python setup.py build_ext --inplace
+define_macros = []
+if os.environ.get("MASSDAWG_CHARGES"):
+    define_macros.append(("MASSDAWG_CHARGES", str(int(os.environ["MASSDAWG_CHARGES"]))))
+if os.environ.get("MASSDAWG_SEARCH_STATS", "0") not in ("", "0"):
+    define_macros.append(("MASSDAWG_SEARCH_STATS", None))
+
 setup(
     name="mass_dawg",
     version="1.2.0", 
@@ -17,10 +25,12 @@ setup(
     long_description=long_description,
     long_description_content_type="text/markdown",
     keywords="bioinformatics mass_spectrometry ms dawg graph prefix",
+    install_requires=["numpy"],
     ext_modules=cythonize(Extension(
         "mass_dawg", 
         ["mass_dawg.pyx"], 
         language="c++", 
+        define_macros=define_macros,
         extra_compile_args=["-std=c++11"]
     ))
 )
\ No newline at end of file
@@ -0,0 +1,247 @@
+#include <algorithm>
+#include <stdexcept>
+#include <unordered_map>
+
+#include "BidirectionalMassDawg.hpp"
+#include "FastaDigester.hpp"
+#include "utils.hpp"
+
+// true if every mass of a sequence can be inserted
+static bool allInRange(const vector<float> & sequence){
+    for (float mass: sequence){
+        if (!fixedMassInRange(mass)) return false;
+    }
+    return true;
+}
+
+BidirectionalMassDawg::BidirectionalMassDawg(){
+    this->bIons = new MassDawg();
+    this->yIons = new MassDawg();
+}
+
+BidirectionalMassDawg::~BidirectionalMassDawg(){
+    delete this->bIons;
+    delete this->yIons;
+}
+
+/**
+ * Add a kmer to both graphs with its singly and doubly charged b and y ion masses
+ *
+ * @param kmer      string      the amino acids of the kmer
+ *
+ * @throws invalid_argument     if the kmer is empty or has a residue without a known mass
+*/
+void BidirectionalMassDawg::insert(const string & kmer){
+    vector<float> bSinglySequence, bDoublySequence, ySinglySequence, yDoublySequence;
+    if (!FastaDigester::bIons(kmer, bSinglySequence, bDoublySequence) || !FastaDigester::yIons(kmer, ySinglySequence, yDoublySequence)){
+        throw invalid_argument("kmer " + kmer + " has a residue without a known mass");
+    }
+
+    this->insert(bSinglySequence, bDoublySequence, ySinglySequence, yDoublySequence, kmer);
+}
+
+/**
+ * Add a kmer to both graphs with masses computed by the caller
+ *
+ * @param bSinglySequence   vector<float>   the singly charged b ion masses, shortest prefix first
+ * @param bDoublySequence   vector<float>   the doubly charged b ion masses, shortest prefix first
+ * @param ySinglySequence   vector<float>   the singly charged y ion masses, shortest suffix first
+ * @param yDoublySequence   vector<float>   the doubly charged y ion masses, shortest suffix first
+ * @param kmer              string          the amino acids of the kmer
+ *
+ * @throws invalid_argument     if the sequences and kmer are not all the same non zero length
+*/
+void BidirectionalMassDawg::insert(const vector<float> & bSinglySequence, const vector<float> & bDoublySequence,
+    const vector<float> & ySinglySequence, const vector<float> & yDoublySequence, const string & kmer){
+
+    // check everything before either graph changes, so they always hold the same kmers
+    size_t length = kmer.size();
+    if (length == 0 || bSinglySequence.size() != length || bDoublySequence.size() != length
+    || ySinglySequence.size() != length || yDoublySequence.size() != length){
+        throw invalid_argument("bSinglySequence, bDoublySequence, ySinglySequence, yDoublySequence and kmer must be the same non zero length");
+    }
+    if (!allInRange(bSinglySequence) || !allInRange(bDoublySequence) || !allInRange(ySinglySequence) || !allInRange(yDoublySequence)){
+        throw invalid_argument("masses must be numbers within the range of a FixedMass");
+    }
+
+    this->bIons->insert(bSinglySequence.data(), bDoublySequence.data(), (int)length, kmer);
+    this->yIons->insert(ySinglySequence.data(), yDoublySequence.data(), (int)length, string(kmer.rbegin(), kmer.rend()));
+}
+
+/**
+ * Remove one insertion of a kmer from both graphs, undoing insert with its
+ * singly and doubly charged b and y ion masses
+ *
+ * @param kmer      string      the amino acids of the kmer
+ *
+ * @return bool     True if the kmer was in the graphs and was removed, False otherwise
+ *
+ * @throws invalid_argument     if the kmer is empty or has a residue without a known mass
+*/
+bool BidirectionalMassDawg::remove(const string & kmer){
+    vector<float> bSinglySequence, bDoublySequence, ySinglySequence, yDoublySequence;
+    if (!FastaDigester::bIons(kmer, bSinglySequence, bDoublySequence) || !FastaDigester::yIons(kmer, ySinglySequence, yDoublySequence)){
+        throw invalid_argument("kmer " + kmer + " has a residue without a known mass");
+    }
+
+    return this->remove(bSinglySequence, bDoublySequence, ySinglySequence, yDoublySequence, kmer);
+}
+
+/**
+ * Remove one insertion of a kmer from both graphs with the masses it was inserted with.
+ * Neither graph changes unless it is removed from both
+ *
+ * @param bSinglySequence   vector<float>   the singly charged b ion masses, shortest prefix first
+ * @param bDoublySequence   vector<float>   the doubly charged b ion masses, shortest prefix first
+ * @param ySinglySequence   vector<float>   the singly charged y ion masses, shortest suffix first
+ * @param yDoublySequence   vector<float>   the doubly charged y ion masses, shortest suffix first
+ * @param kmer              string          the amino acids of the kmer
+ *
+ * @return bool     True if the kmer was in the graphs and was removed, False otherwise
+ *
+ * @throws invalid_argument     if the sequences and kmer are not all the same non zero length
+*/
+bool BidirectionalMassDawg::remove(const vector<float> & bSinglySequence, const vector<float> & bDoublySequence,
+    const vector<float> & ySinglySequence, const vector<float> & yDoublySequence, const string & kmer){
+
+    size_t length = kmer.size();
+    if (length == 0 || bSinglySequence.size() != length || bDoublySequence.size() != length
+    || ySinglySequence.size() != length || yDoublySequence.size() != length){
+        throw invalid_argument("bSinglySequence, bDoublySequence, ySinglySequence, yDoublySequence and kmer must be the same non zero length");
+    }
+    if (!allInRange(bSinglySequence) || !allInRange(bDoublySequence) || !allInRange(ySinglySequence) || !allInRange(yDoublySequence)){
+        throw invalid_argument("masses must be numbers within the range of a FixedMass");
+    }
+
+    if (!this->bIons->remove(bSinglySequence.data(), bDoublySequence.data(), (int)length, kmer)) return false;
+
+    string reversed(kmer.rbegin(), kmer.rend());
+    if (!this->yIons->remove(ySinglySequence.data(), yDoublySequence.data(), (int)length, reversed)){
+        // inserting undoes a removal, so both graphs still hold the same kmers
+        this->bIons->insert(bSinglySequence.data(), bDoublySequence.data(), (int)length, kmer);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Merge the remaining nodes of both graphs
+*/
+void BidirectionalMassDawg::finish(){
+    this->bIons->finish();
+    this->yIons->finish();
+}
+
+/**
+ * Search both graphs allowing for up to gapAllowance missed masses in each
+ *
+ * @param sequence      vector<float>   the sequence to search
+ * @param gapAllowance  int             the number of missed masses to allow in each graph
+ * @param ppmTol        int             the tolerance in parts per million to accept when searching
+ * @param stats         SearchStats *   counters for the searches of both graphs, or null
+ *
+ * @return vector<string>   the kmers with a prefix and a suffix found that cover them, sorted
+*/
+vector<string> BidirectionalMassDawg::fuzzySearch(const vector<float> & sequence, int gapAllowance, int ppmTol, SearchStats * stats) const {
+    return this->fuzzySearch(sequence.data(), (int)sequence.size(), gapAllowance, ppmTol, stats);
+}
+
+/**
+ * Search both graphs for an array of masses allowing for up to gapAllowance missed masses in each
+ *
+ * @param sequence      const float *   the sequence to search
+ * @param length        int             the number of masses in sequence
+ * @param gapAllowance  int             the number of missed masses to allow in each graph
+ * @param ppmTol        int             the tolerance in parts per million to accept when searching
+ * @param stats         SearchStats *   counters for the searches of both graphs, or null
+ *
+ * @return vector<string>   the kmers with a prefix and a suffix found that cover them, sorted
+*/
+vector<string> BidirectionalMassDawg::fuzzySearch(const float * sequence, int length, int gapAllowance, int ppmTol, SearchStats * stats) const {
+    vector<string> bResults = this->bIons->fuzzySearch(sequence, length, gapAllowance, ppmTol, stats);
+    if (bResults.empty()) return bResults;
+
+    return this->join(bResults, this->yIons->fuzzySearch(sequence, length, gapAllowance, ppmTol, stats));
+}
+
+/**
+ * Search both graphs with no missed masses
+ *
+ * @param sequence      vector<float>   the sequence to search
+ * @param ppmTol        int             the tolerance in parts per million to accept when searching
+ * @param stats         SearchStats *   counters for the searches of both graphs, or null
+ *
+ * @return vector<string>   the kmers with a prefix and a suffix found that cover them, sorted
+*/
+vector<string> BidirectionalMassDawg::search(const vector<float> & sequence, int ppmTol, SearchStats * stats) const {
+    return this->search(sequence.data(), (int)sequence.size(), ppmTol, stats);
+}
+
+/**
+ * Search both graphs for an array of masses with no missed masses
+ *
+ * @param sequence      const float *   the sequence to search
+ * @param length        int             the number of masses in sequence
+ * @param ppmTol        int             the tolerance in parts per million to accept when searching
+ * @param stats         SearchStats *   counters for the searches of both graphs, or null
+ *
+ * @return vector<string>   the kmers with a prefix and a suffix found that cover them, sorted
+*/
+vector<string> BidirectionalMassDawg::search(const float * sequence, int length, int ppmTol, SearchStats * stats) const {
+    vector<string> bResults = this->bIons->search(sequence, length, ppmTol, stats);
+    if (bResults.empty()) return bResults;
+
+    return this->join(bResults, this->yIons->search(sequence, length, ppmTol, stats));
+}
+
+/**
+ * Join every prefix found in the b ion graph with every suffix found in the y ion
+ * graph that it meets or overlaps, keeping the joins that are kmers of the graph
+ *
+ * @param prefixes  vector<string>  the kmers found in the b ion graph
+ * @param suffixes  vector<string>  the reversed kmers found in the y ion graph
+ *
+ * @return vector<string>   the kmers, sorted with no repeats
+*/
+vector<string> BidirectionalMassDawg::join(vector<string> prefixes, vector<string> suffixes) const {
+    for (string & suffix: suffixes) reverse(suffix.begin(), suffix.end());
+
+    // searches can return the same kmer more than once
+    sort(prefixes.begin(), prefixes.end());
+    prefixes.erase(unique(prefixes.begin(), prefixes.end()), prefixes.end());
+    sort(suffixes.begin(), suffixes.end());
+    suffixes.erase(unique(suffixes.begin(), suffixes.end()), suffixes.end());
+
+    // the suffixes by their first residues, for every overlap but none, so a prefix only
+    // meets the suffixes that start with its last residues
+    unordered_map<string, vector<const string *> > suffixesByStart;
+    for (const string & suffix: suffixes){
+        for (size_t overlap = 1; overlap <= suffix.size(); overlap++) suffixesByStart[suffix.substr(0, overlap)].push_back(&suffix);
+    }
+
+    vector<string> joined;
+    // reused, so a join that is not a kmer of the graph allocates nothing
+    string kmer, end;
+    auto tryJoin = [&](const string & prefix, const string & suffix, size_t overlap){
+        kmer.assign(prefix);
+        kmer.append(suffix, overlap, string::npos);
+        if (this->bIons->insertionCount(kmer) > 0) joined.push_back(kmer);
+    };
+
+    for (const string & prefix: prefixes){
+        // every suffix meets the prefix end to end
+        for (const string & suffix: suffixes) tryJoin(prefix, suffix, 0);
+
+        for (size_t overlap = 1; overlap <= prefix.size(); overlap++){
+            end.assign(prefix, prefix.size() - overlap, overlap);
+
+            auto found = suffixesByStart.find(end);
+            if (found == suffixesByStart.end()) continue;
+            for (const string * suffix: found->second) tryJoin(prefix, *suffix, overlap);
+        }
+    }
+
+    sort(joined.begin(), joined.end());
+    joined.erase(unique(joined.begin(), joined.end()), joined.end());
+    return joined;
+}
@@ -0,0 +1,162 @@
+#ifndef BIDIRECTIONALMASSDAWG_H
+#define BIDIRECTIONALMASSDAWG_H
+
+#include <vector>
+#include <string>
+
+#include "MassDawg.hpp"
+#include "SearchStats.hpp"
+
+using namespace std;
+
+/**
+ * A pair of graphs over the same kmers: one of the b ions of each kmer, read from
+ * the N terminus like a MassDawg, and one of the y ions, read from the C terminus.
+ * The y ion graph holds each kmer reversed, so its prefixes are the suffixes of the
+ * kmer and are reversed back when they are returned.
+ *
+ * A search walks both graphs with the whole spectrum. The b ions find prefixes and
+ * the y ions find suffixes, and a kmer is returned only if one of each meets or
+ * overlaps in it, so every residue of the kmer is explained from one end or the
+ * other. Prefixes shared by many kmers are dropped unless the y ions agree with
+ * one of them. The y ion graph is not searched at all when the b ions find nothing.
+*/
+class BidirectionalMassDawg {
+public:
+    BidirectionalMassDawg();
+
+    ~BidirectionalMassDawg();
+
+    // each graph owns its nodes, so the pair can not be copied
+    BidirectionalMassDawg(const BidirectionalMassDawg &) = delete;
+    BidirectionalMassDawg & operator=(const BidirectionalMassDawg &) = delete;
+
+    /**
+     * Add a kmer to both graphs with its singly and doubly charged b and y ion masses
+     *
+     * @param kmer      string      the amino acids of the kmer
+     *
+     * @throws invalid_argument     if the kmer is empty or has a residue without a known mass
+    */
+    void insert(const string & kmer);
+
+    /**
+     * Add a kmer to both graphs with masses computed by the caller
+     *
+     * @param bSinglySequence   vector<float>   the singly charged b ion masses, shortest prefix first
+     * @param bDoublySequence   vector<float>   the doubly charged b ion masses, shortest prefix first
+     * @param ySinglySequence   vector<float>   the singly charged y ion masses, shortest suffix first
+     * @param yDoublySequence   vector<float>   the doubly charged y ion masses, shortest suffix first
+     * @param kmer              string          the amino acids of the kmer
+     *
+     * @throws invalid_argument     if the sequences and kmer are not all the same non zero length
+    */
+    void insert(const vector<float> & bSinglySequence, const vector<float> & bDoublySequence,
+        const vector<float> & ySinglySequence, const vector<float> & yDoublySequence, const string & kmer);
+
+    /**
+     * Remove one insertion of a kmer from both graphs, undoing insert with its
+     * singly and doubly charged b and y ion masses
+     *
+     * @param kmer      string      the amino acids of the kmer
+     *
+     * @return bool     True if the kmer was in the graphs and was removed, False otherwise
+     *
+     * @throws invalid_argument     if the kmer is empty or has a residue without a known mass
+    */
+    bool remove(const string & kmer);
+
+    /**
+     * Remove one insertion of a kmer from both graphs with the masses it was inserted with.
+     * Neither graph changes unless it is removed from both
+     *
+     * @param bSinglySequence   vector<float>   the singly charged b ion masses, shortest prefix first
+     * @param bDoublySequence   vector<float>   the doubly charged b ion masses, shortest prefix first
+     * @param ySinglySequence   vector<float>   the singly charged y ion masses, shortest suffix first
+     * @param yDoublySequence   vector<float>   the doubly charged y ion masses, shortest suffix first
+     * @param kmer              string          the amino acids of the kmer
+     *
+     * @return bool     True if the kmer was in the graphs and was removed, False otherwise
+     *
+     * @throws invalid_argument     if the sequences and kmer are not all the same non zero length
+    */
+    bool remove(const vector<float> & bSinglySequence, const vector<float> & bDoublySequence,
+        const vector<float> & ySinglySequence, const vector<float> & yDoublySequence, const string & kmer);
+
+    /**
+     * Merge the remaining nodes of both graphs
+    */
+    void finish();
+
+    /**
+     * Search both graphs allowing for up to gapAllowance missed masses in each
+     *
+     * @param sequence      vector<float>   the sequence to search
+     * @param gapAllowance  int             the number of missed masses to allow in each graph
+     * @param ppmTol        int             the tolerance in parts per million to accept when searching
+     * @param stats         SearchStats *   counters for the searches of both graphs, or null
+     *
+     * @return vector<string>   the kmers with a prefix and a suffix found that cover them, sorted
+    */
+    vector<string> fuzzySearch(const vector<float> & sequence, int gapAllowance, int ppmTol, SearchStats * stats = nullptr) const;
+
+    /**
+     * Search both graphs for an array of masses allowing for up to gapAllowance missed masses in each
+     *
+     * @param sequence      const float *   the sequence to search
+     * @param length        int             the number of masses in sequence
+     * @param gapAllowance  int             the number of missed masses to allow in each graph
+     * @param ppmTol        int             the tolerance in parts per million to accept when searching
+     * @param stats         SearchStats *   counters for the searches of both graphs, or null
+     *
+     * @return vector<string>   the kmers with a prefix and a suffix found that cover them, sorted
+    */
+    vector<string> fuzzySearch(const float * sequence, int length, int gapAllowance, int ppmTol, SearchStats * stats = nullptr) const;
+
+    /**
+     * Search both graphs with no missed masses
+     *
+     * @param sequence      vector<float>   the sequence to search
+     * @param ppmTol        int             the tolerance in parts per million to accept when searching
+     * @param stats         SearchStats *   counters for the searches of both graphs, or null
+     *
+     * @return vector<string>   the kmers with a prefix and a suffix found that cover them, sorted
+    */
+    vector<string> search(const vector<float> & sequence, int ppmTol, SearchStats * stats = nullptr) const;
+
+    /**
+     * Search both graphs for an array of masses with no missed masses
+     *
+     * @param sequence      const float *   the sequence to search
+     * @param length        int             the number of masses in sequence
+     * @param ppmTol        int             the tolerance in parts per million to accept when searching
+     * @param stats         SearchStats *   counters for the searches of both graphs, or null
+     *
+     * @return vector<string>   the kmers with a prefix and a suffix found that cover them, sorted
+    */
+    vector<string> search(const float * sequence, int length, int ppmTol, SearchStats * stats = nullptr) const;
+
+    // the graph of b ions, searched and frozen like any MassDawg
+    MassDawg * bIonDawg() { return this->bIons; }
+
+    // the graph of y ions. Its kmers are reversed
+    MassDawg * yIonDawg() { return this->yIons; }
+
+private:
+    // both graphs always hold the same kmers, so the joined prefixes and suffixes
+    // are checked against the insertions of the b ion graph
+    MassDawg * bIons;
+    MassDawg * yIons;
+
+    /**
+     * Join every prefix found in the b ion graph with every suffix found in the y ion
+     * graph that it meets or overlaps, keeping the joins that are kmers of the graph
+     *
+     * @param prefixes  vector<string>  the kmers found in the b ion graph
+     * @param suffixes  vector<string>  the reversed kmers found in the y ion graph
+     *
+     * @return vector<string>   the kmers, sorted with no repeats
+    */
+    vector<string> join(vector<string> prefixes, vector<string> suffixes) const;
+};
+#endif
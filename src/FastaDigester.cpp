@@ -0,0 +1,319 @@
+#include <fstream>
+#include <algorithm>
+#include <stdexcept>
+#include <cctype>
+
+#include "FastaDigester.hpp"
+
+/**
+ * Get the monoisotopic mass of an amino acid
+ *
+ * @param residue   char    the one letter code of the amino acid
+ *
+ * @return double   the monoisotopic mass, or 0 if the residue is not known
+*/
+double FastaDigester::residueMass(char residue){
+    switch (residue){
+        case 'A': return 71.03711;
+        case 'C': return 103.00919;
+        case 'D': return 115.02694;
+        case 'E': return 129.04259;
+        case 'F': return 147.06841;
+        case 'G': return 57.02146;
+        case 'H': return 137.05891;
+        case 'I': return 113.08406;
+        case 'K': return 128.09496;
+        case 'L': return 113.08406;
+        case 'M': return 131.04049;
+        case 'N': return 114.04293;
+        case 'P': return 97.05276;
+        case 'Q': return 128.05858;
+        case 'R': return 156.10111;
+        case 'S': return 87.03203;
+        case 'T': return 101.04768;
+        case 'V': return 99.06841;
+        case 'W': return 186.07931;
+        case 'Y': return 163.06333;
+        default: return 0;
+    }
+}
+
+/**
+ * @param maxLength     int     the longest kmer to insert from each position
+ * @param chunkSize     int     the number of kmers to collect and sort before inserting them
+*/
+FastaDigester::FastaDigester(int maxLength, int chunkSize){
+    if (maxLength < 1) throw invalid_argument("maxLength must be at least 1");
+
+    this->maxLength = maxLength;
+    this->chunkSize = chunkSize > 0 ? chunkSize : 1;
+}
+
+/**
+ * Insert the kmers of every protein in a FASTA stream into the graph. The graph is
+ * not finished afterwards
+ *
+ * @param fasta     istream &       the FASTA formatted proteins
+ * @param dawg      MassDawg *      the graph to insert into
+ *
+ * @return int      the number of kmers inserted
+*/
+int FastaDigester::digest(istream & fasta, MassDawg * dawg){
+    int inserted = 0;
+    string line;
+    string protein;
+
+    while (getline(fasta, line)){
+        // a header starts the next protein
+        if (!line.empty() && line[0] == '>'){
+            inserted += this->addProtein(protein, dawg);
+            protein.clear();
+            continue;
+        }
+
+        for (char c: line){
+            if (isalpha((unsigned char)c)) protein += (char)toupper((unsigned char)c);
+        }
+    }
+    inserted += this->addProtein(protein, dawg);
+    inserted += this->flush(dawg);
+
+    return inserted;
+}
+
+/**
+ * Insert the kmers of every protein in a FASTA file into the graph. The graph is
+ * not finished afterwards
+ *
+ * @param fastaFile     string          the path to the FASTA file
+ * @param dawg          MassDawg *      the graph to insert into
+ *
+ * @return int      the number of kmers inserted
+ *
+ * @throws runtime_error    if the file can not be opened
+*/
+int FastaDigester::digestFile(const string & fastaFile, MassDawg * dawg){
+    ifstream fasta(fastaFile);
+    if (!fasta.is_open()) throw runtime_error("could not open " + fastaFile);
+
+    return this->digest(fasta, dawg);
+}
+
+/**
+ * Remove the kmers of one protein from the graph, undoing what digest inserted
+ * for it. Kmers that other proteins share stay in the graph until every protein
+ * they came from is removed
+ *
+ * @param protein   string          the amino acids of the protein
+ * @param dawg      MassDawg *      the graph to remove from
+ *
+ * @return int      the number of kmers removed
+*/
+int FastaDigester::removeProtein(const string & protein, MassDawg * dawg){
+    // read the same way digest reads the lines of a protein
+    string residues;
+    for (char c: protein){
+        if (isalpha((unsigned char)c)) residues += (char)toupper((unsigned char)c);
+    }
+
+    int removed = 0;
+    vector<NodeMasses> masses;
+    for (int i = 0; i < (int)residues.size(); i++){
+        masses.clear();
+        int length = this->kmerMasses(residues, i, masses);
+        if (length == 0) continue;
+
+        if (dawg->remove(masses.data(), length, residues.substr(i, length))) removed ++;
+    }
+    return removed;
+}
+
+/**
+ * Remove the kmers of every protein in a FASTA stream from the graph, such as
+ * a set of decoys that was digested into it before
+ *
+ * @param fasta     istream &       the FASTA formatted proteins
+ * @param dawg      MassDawg *      the graph to remove from
+ *
+ * @return int      the number of kmers removed
+*/
+int FastaDigester::undigest(istream & fasta, MassDawg * dawg){
+    int removed = 0;
+    string line;
+    string protein;
+
+    while (getline(fasta, line)){
+        if (!line.empty() && line[0] == '>'){
+            removed += this->removeProtein(protein, dawg);
+            protein.clear();
+            continue;
+        }
+        protein += line;
+    }
+    removed += this->removeProtein(protein, dawg);
+
+    return removed;
+}
+
+/**
+ * Remove the kmers of every protein in a FASTA file from the graph
+ *
+ * @param fastaFile     string          the path to the FASTA file
+ * @param dawg          MassDawg *      the graph to remove from
+ *
+ * @return int      the number of kmers removed
+ *
+ * @throws runtime_error    if the file can not be opened
+*/
+int FastaDigester::undigestFile(const string & fastaFile, MassDawg * dawg){
+    ifstream fasta(fastaFile);
+    if (!fasta.is_open()) throw runtime_error("could not open " + fastaFile);
+
+    return this->undigest(fasta, dawg);
+}
+
+/**
+ * Compute the singly and doubly charged b ion masses of a kmer
+ *
+ * @param kmer              string              the amino acids of the kmer
+ * @param singlySequence    vector<float> &     filled with the singly charged masses
+ * @param doublySequence    vector<float> &     filled with the doubly charged masses
+ *
+ * @return bool     False if the kmer has a residue without a known mass, True otherwise
+*/
+bool FastaDigester::bIons(const string & kmer, vector<float> & singlySequence, vector<float> & doublySequence){
+    singlySequence.clear();
+    doublySequence.clear();
+
+    double mass = 0;
+    for (char residue: kmer){
+        double aaMass = FastaDigester::residueMass(residue);
+        if (aaMass == 0) return false;
+
+        mass += aaMass;
+        singlySequence.push_back((float)(mass + PROTON_MASS));
+        doublySequence.push_back((float)((mass + 2 * PROTON_MASS) / 2));
+    }
+    return true;
+}
+
+/**
+ * Compute the singly and doubly charged y ion masses of a kmer, shortest suffix first
+ *
+ * @param kmer              string              the amino acids of the kmer
+ * @param singlySequence    vector<float> &     filled with the singly charged masses
+ * @param doublySequence    vector<float> &     filled with the doubly charged masses
+ *
+ * @return bool     False if the kmer has a residue without a known mass, True otherwise
+*/
+bool FastaDigester::yIons(const string & kmer, vector<float> & singlySequence, vector<float> & doublySequence){
+    singlySequence.clear();
+    doublySequence.clear();
+
+    // y ions keep the water of the C terminus
+    double mass = WATER_MASS;
+    for (int i = (int)kmer.size() - 1; i >= 0; i--){
+        double aaMass = FastaDigester::residueMass(kmer[i]);
+        if (aaMass == 0) return false;
+
+        mass += aaMass;
+        singlySequence.push_back((float)(mass + PROTON_MASS));
+        doublySequence.push_back((float)((mass + 2 * PROTON_MASS) / 2));
+    }
+    return true;
+}
+
+/**
+ * Add the kmers starting at each position of a protein to the chunk,
+ * inserting the chunk whenever it is full
+ *
+ * @param protein   string          the amino acids of the protein
+ * @param dawg      MassDawg *      the graph to insert into
+ *
+ * @return int      the number of kmers inserted
+*/
+int FastaDigester::addProtein(const string & protein, MassDawg * dawg){
+    int inserted = 0;
+
+    // the kmers of the protein all point into one copy of it
+    uint32_t proteinStart = (uint32_t)this->residues.size();
+    this->residues += protein;
+
+    for (int i = 0; i < (int)protein.size(); i++){
+        uint32_t length = (uint32_t)this->kmerMasses(protein, i, this->masses);
+        if (length == 0) continue;
+
+        this->starts.push_back(proteinStart + i);
+        this->lengths.push_back(length);
+
+        if ((int)this->starts.size() >= this->chunkSize){
+            inserted += this->flush(dawg);
+
+            // the rest of the protein is still needed by the next chunk
+            this->residues = protein;
+            proteinStart = 0;
+        }
+    }
+    return inserted;
+}
+
+/**
+ * Compute the masses of the kmer starting at a position of a protein
+ *
+ * @param protein   string                  the amino acids of the protein
+ * @param start     int                     where the kmer starts
+ * @param masses    vector<NodeMasses> &    the masses of each node of the kmer are appended to this
+ *
+ * @return int      the length of the kmer, which stops before any residue without a mass
+*/
+int FastaDigester::kmerMasses(const string & protein, int start, vector<NodeMasses> & masses) const {
+    int length = 0;
+    double mass = 0;
+
+    while (length < this->maxLength && start + length < (int)protein.size()){
+        double aaMass = FastaDigester::residueMass(protein[start + length]);
+        if (aaMass == 0) break;
+
+        mass += aaMass;
+        // rounded through float first to give the same masses as bIons and insert
+        masses.push_back(nodeMasses(toFixedMass((float)(mass + PROTON_MASS)), toFixedMass((float)((mass + 2 * PROTON_MASS) / 2))));
+        length ++;
+    }
+    return length;
+}
+
+/**
+ * Sort the kmers of the chunk by mass, insert them and empty the chunk
+ *
+ * @param dawg      MassDawg *      the graph to insert into
+ *
+ * @return int      the number of kmers inserted
+*/
+int FastaDigester::flush(MassDawg * dawg){
+    int count = (int)this->starts.size();
+
+    // kmer i has its masses at massStarts[i]
+    vector<uint32_t> massStarts(count);
+    for (int i = 1; i < count; i++) massStarts[i] = massStarts[i - 1] + this->lengths[i - 1];
+
+    vector<int> order(count);
+    for (int i = 0; i < count; i++) order[i] = i;
+
+    // the same order insert uses to detect sorted input
+    sort(order.begin(), order.end(), [&](int a, int b){
+        const NodeMasses * massesA = this->masses.data() + massStarts[a];
+        const NodeMasses * massesB = this->masses.data() + massStarts[b];
+        return lexicographical_compare(massesA, massesA + this->lengths[a], massesB, massesB + this->lengths[b]);
+    });
+
+    for (int i: order){
+        dawg->insert(this->masses.data() + massStarts[i], (int)this->lengths[i], this->residues.substr(this->starts[i], this->lengths[i]));
+    }
+
+    this->residues.clear();
+    this->starts.clear();
+    this->lengths.clear();
+    this->masses.clear();
+
+    return count;
+}
@@ -0,0 +1,166 @@
+#ifndef FASTADIGESTER_H
+#define FASTADIGESTER_H
+
+#include <vector>
+#include <string>
+#include <istream>
+#include <cstdint>
+
+#include "MassDawg.hpp"
+#include "utils.hpp"
+
+#define WATER_MASS      18.0105646837
+
+using namespace std;
+
+/**
+ * Streams proteins out of a FASTA file and inserts the kmers starting at every
+ * position of every protein (up to a max length) into a MassDawg. The masses are
+ * the singly and doubly charged b ions of each kmer. Kmers are collected in chunks
+ * that are sorted by mass before they are inserted, so most insertions take the
+ * sorted fast path while only one chunk is held in memory at a time. The kmers of
+ * proteins digested earlier can be removed again one protein or one file at a time.
+*/
+class FastaDigester {
+public:
+    /**
+     * @param maxLength     int     the longest kmer to insert from each position
+     * @param chunkSize     int     the number of kmers to collect and sort before inserting them
+    */
+    FastaDigester(int maxLength, int chunkSize = 100000);
+
+    ~FastaDigester(){}
+
+    /**
+     * Insert the kmers of every protein in a FASTA stream into the graph. The graph is
+     * not finished afterwards
+     *
+     * @param fasta     istream &       the FASTA formatted proteins
+     * @param dawg      MassDawg *      the graph to insert into
+     *
+     * @return int      the number of kmers inserted
+    */
+    int digest(istream & fasta, MassDawg * dawg);
+
+    /**
+     * Insert the kmers of every protein in a FASTA file into the graph. The graph is
+     * not finished afterwards
+     *
+     * @param fastaFile     string          the path to the FASTA file
+     * @param dawg          MassDawg *      the graph to insert into
+     *
+     * @return int      the number of kmers inserted
+     *
+     * @throws runtime_error    if the file can not be opened
+    */
+    int digestFile(const string & fastaFile, MassDawg * dawg);
+
+    /**
+     * Remove the kmers of one protein from the graph, undoing what digest inserted
+     * for it. Kmers that other proteins share stay in the graph until every protein
+     * they came from is removed
+     *
+     * @param protein   string          the amino acids of the protein
+     * @param dawg      MassDawg *      the graph to remove from
+     *
+     * @return int      the number of kmers removed
+    */
+    int removeProtein(const string & protein, MassDawg * dawg);
+
+    /**
+     * Remove the kmers of every protein in a FASTA stream from the graph, such as
+     * a set of decoys that was digested into it before
+     *
+     * @param fasta     istream &       the FASTA formatted proteins
+     * @param dawg      MassDawg *      the graph to remove from
+     *
+     * @return int      the number of kmers removed
+    */
+    int undigest(istream & fasta, MassDawg * dawg);
+
+    /**
+     * Remove the kmers of every protein in a FASTA file from the graph
+     *
+     * @param fastaFile     string          the path to the FASTA file
+     * @param dawg          MassDawg *      the graph to remove from
+     *
+     * @return int      the number of kmers removed
+     *
+     * @throws runtime_error    if the file can not be opened
+    */
+    int undigestFile(const string & fastaFile, MassDawg * dawg);
+
+    /**
+     * Get the monoisotopic mass of an amino acid
+     *
+     * @param residue   char    the one letter code of the amino acid
+     *
+     * @return double   the mass, or 0 if the residue is not known
+    */
+    static double residueMass(char residue);
+
+    /**
+     * Compute the singly and doubly charged b ion masses of a kmer
+     *
+     * @param kmer              string              the amino acids of the kmer
+     * @param singlySequence    vector<float> &     filled with the singly charged masses
+     * @param doublySequence    vector<float> &     filled with the doubly charged masses
+     *
+     * @return bool     False if the kmer has a residue without a known mass, True otherwise
+    */
+    static bool bIons(const string & kmer, vector<float> & singlySequence, vector<float> & doublySequence);
+
+    /**
+     * Compute the singly and doubly charged y ion masses of a kmer, shortest suffix first
+     *
+     * @param kmer              string              the amino acids of the kmer
+     * @param singlySequence    vector<float> &     filled with the singly charged masses
+     * @param doublySequence    vector<float> &     filled with the doubly charged masses
+     *
+     * @return bool     False if the kmer has a residue without a known mass, True otherwise
+    */
+    static bool yIons(const string & kmer, vector<float> & singlySequence, vector<float> & doublySequence);
+
+private:
+    int maxLength;
+    int chunkSize;
+
+    // the kmers of the current chunk. Kmer i is residues[starts[i], starts[i] + lengths[i])
+    // and the masses of its nodes are at the same positions in masses
+    string residues;
+    vector<uint32_t> starts;
+    vector<uint32_t> lengths;
+    vector<NodeMasses> masses;
+
+    /**
+     * Add the kmers starting at each position of a protein to the chunk,
+     * inserting the chunk whenever it is full
+     *
+     * @param protein   string          the amino acids of the protein
+     * @param dawg      MassDawg *      the graph to insert into
+     *
+     * @return int      the number of kmers inserted
+    */
+    int addProtein(const string & protein, MassDawg * dawg);
+
+    /**
+     * Compute the masses of the kmer starting at a position of a protein
+     *
+     * @param protein   string                  the amino acids of the protein
+     * @param start     int                     where the kmer starts
+     * @param masses    vector<NodeMasses> &    the masses of each node of the kmer are appended to this
+     *
+     * @return int      the length of the kmer, which stops before any residue without a mass
+    */
+    int kmerMasses(const string & protein, int start, vector<NodeMasses> & masses) const;
+
+    /**
+     * Sort the kmers of the chunk by mass, insert them and empty the chunk
+     *
+     * @param dawg      MassDawg *      the graph to insert into
+     *
+     * @return int      the number of kmers inserted
+    */
+    int flush(MassDawg * dawg);
+};
+#endif
@@ -0,0 +1,572 @@
+#include <unordered_map>
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "FrozenMassDawg.hpp"
+#include "GraphSearch.hpp"
+
+// the first bytes of every saved graph
+#define FROZEN_MAGIC        "MASSDAWG"
+// written in the byte order of the machine that saved the graph
+#define FROZEN_BYTE_ORDER   0x01020304
+
+// the start of the file layout, followed by each array aligned to 8 bytes
+struct FrozenFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    // the number of masses of each node, MASSDAWG_CHARGES of the build that saved it
+    uint32_t charges;
+    uint32_t nodes;
+    uint32_t edges;
+    uint32_t kmerIds;
+    uint32_t kmers;
+    // the length of the longest kmer, so loading does not have to read every length
+    uint32_t longestKmer;
+    uint64_t chars;
+};
+
+// byte offsets of the arrays in the file layout
+class FrozenLayout {
+public:
+    size_t masses, childOffsets, children, kmerOffsets, kmerIds, kmerStarts, kmerLengths, kmerChars;
+    // the size of the whole layout
+    size_t length;
+
+    FrozenLayout(const FrozenFileHeader & header){
+        this->length = sizeof(FrozenFileHeader);
+        this->masses = this->add((size_t)header.nodes * header.charges * sizeof(FixedMass));
+        this->childOffsets = this->add(((size_t)header.nodes + 1) * sizeof(uint32_t));
+        this->children = this->add(header.edges * sizeof(uint32_t));
+        this->kmerOffsets = this->add(((size_t)header.nodes + 1) * sizeof(uint32_t));
+        this->kmerIds = this->add(header.kmerIds * sizeof(uint32_t));
+        this->kmerStarts = this->add(header.kmers * sizeof(uint32_t));
+        this->kmerLengths = this->add(header.kmers * sizeof(uint32_t));
+        this->kmerChars = this->add(header.chars);
+    }
+
+private:
+    // place an array of bytes at the end of the layout and get its offset
+    size_t add(size_t bytes){
+        size_t offset = this->length;
+        this->length = (offset + bytes + 7) & ~(size_t)7;
+        return offset;
+    }
+};
+
+/*******************Public methods*******************/
+
+/**
+ * Finish the dawg and compile it into the flat layout. The dawg is not
+ * changed after the final minimization and can be deleted afterwards
+ *
+ * @param dawg      MassDawg *      the graph to freeze
+*/
+FrozenMassDawg::FrozenMassDawg(MassDawg * dawg) : FrozenMassDawg() {
+    dawg->finish();
+
+    // give every reachable node an index in the order it is discovered
+    // by a depth first walk so children end up close to their parents in memory
+    unordered_map<const MassDawgNode *, Node> nodeIndex;
+    vector<const MassDawgNode *> byIndex {dawg->root};
+    vector<const MassDawgNode *> stack {dawg->root};
+    nodeIndex.insert({dawg->root, 0});
+
+    while (!stack.empty()){
+        const MassDawgNode * node = stack.back();
+        stack.pop_back();
+
+        for (const MassDawgNode * child: node->children){
+            if (nodeIndex.find(child) != nodeIndex.end()) continue;
+
+            nodeIndex.insert({child, (Node)byIndex.size()});
+            byIndex.push_back(child);
+            stack.push_back(child);
+        }
+    }
+
+    // removed kmers stay in the table of the dawg, so only the kmers some node
+    // holds are frozen. They are given new ids in the order of their old ones
+    const KmerTable & kmers = dawg->kmers;
+    vector<uint32_t> frozenIds(kmers.size(), UINT32_MAX);
+    for (const MassDawgNode * node: byIndex){
+        for (uint32_t kmer: node->kmers) frozenIds[kmer] = 0;
+    }
+
+    vector<uint32_t> held;
+    for (uint32_t id = 0; id < (uint32_t)kmers.size(); id++){
+        if (frozenIds[id] == UINT32_MAX) continue;
+
+        frozenIds[id] = (uint32_t)held.size();
+        held.push_back(id);
+    }
+
+    vector<NodeMasses> masses;
+    vector<uint32_t> childOffsets {0}, kmerOffsets {0};
+    vector<Node> children;
+    vector<uint32_t> kmerIds;
+
+    for (const MassDawgNode * node: byIndex){
+        masses.push_back(node->masses);
+
+        for (const MassDawgNode * child: node->children) children.push_back(nodeIndex[child]);
+        childOffsets.push_back((uint32_t)children.size());
+
+        for (uint32_t kmer: node->kmers) kmerIds.push_back(frozenIds[kmer]);
+        kmerOffsets.push_back((uint32_t)kmerIds.size());
+    }
+
+    // prefixes point into the characters of longer kmers, so copy each run of
+    // characters that held kmers overlap once and keep them pointing into it
+    vector<uint32_t> byOffset = held;
+    sort(byOffset.begin(), byOffset.end(), [&](uint32_t a, uint32_t b){ return kmers.offset(a) < kmers.offset(b); });
+
+    string kmerChars;
+    vector<uint32_t> kmerStarts(held.size()), kmerLengths(held.size());
+    uint32_t runStart = 0, runEnd = 0, frozenRunStart = 0;
+    for (int i = 0; i < (int)byOffset.size(); i++){
+        uint32_t id = byOffset[i];
+        uint32_t start = kmers.offset(id), end = start + kmers.length(id);
+
+        if (i == 0 || start > runEnd){
+            runStart = runEnd = start;
+            frozenRunStart = (uint32_t)kmerChars.size();
+        }
+        if (end > runEnd){
+            kmerChars.append(kmers.characters(), runEnd, end - runEnd);
+            runEnd = end;
+        }
+
+        kmerStarts[frozenIds[id]] = frozenRunStart + (start - runStart);
+        kmerLengths[frozenIds[id]] = kmers.length(id);
+    }
+
+    // lay everything out the way it is saved
+    FrozenFileHeader header;
+    memcpy(header.magic, FROZEN_MAGIC, sizeof(header.magic));
+    header.version = FROZEN_FORMAT_VERSION;
+    header.byteOrder = FROZEN_BYTE_ORDER;
+    header.charges = MASSDAWG_CHARGES;
+    header.nodes = (uint32_t)byIndex.size();
+    header.edges = (uint32_t)children.size();
+    header.kmerIds = (uint32_t)kmerIds.size();
+    header.kmers = (uint32_t)kmerStarts.size();
+    header.longestKmer = 0;
+    for (uint32_t length: kmerLengths) header.longestKmer = max(header.longestKmer, length);
+    header.chars = kmerChars.size();
+
+    FrozenLayout layout(header);
+    this->storage = vector<uint64_t>(layout.length / sizeof(uint64_t), 0);
+    char * buffer = (char *)this->storage.data();
+
+    memcpy(buffer, &header, sizeof(header));
+    memcpy(buffer + layout.masses, masses.data(), masses.size() * sizeof(NodeMasses));
+    memcpy(buffer + layout.childOffsets, childOffsets.data(), childOffsets.size() * sizeof(uint32_t));
+    memcpy(buffer + layout.children, children.data(), children.size() * sizeof(Node));
+    memcpy(buffer + layout.kmerOffsets, kmerOffsets.data(), kmerOffsets.size() * sizeof(uint32_t));
+    memcpy(buffer + layout.kmerIds, kmerIds.data(), kmerIds.size() * sizeof(uint32_t));
+    memcpy(buffer + layout.kmerStarts, kmerStarts.data(), kmerStarts.size() * sizeof(uint32_t));
+    memcpy(buffer + layout.kmerLengths, kmerLengths.data(), kmerLengths.size() * sizeof(uint32_t));
+    memcpy(buffer + layout.kmerChars, kmerChars.data(), header.chars);
+
+    this->base = buffer;
+    this->length = layout.length;
+    this->attach(buffer, layout.length, false);
+}
+
+// unmaps the file of a loaded graph
+FrozenMassDawg::~FrozenMassDawg(){
+    if (this->mapped) munmap((void *)this->base, this->length);
+}
+
+/**
+ * Write the graph to a file that load can map
+ *
+ * @param path      string      where to write the graph
+ *
+ * @throws runtime_error    if the file can not be written
+*/
+void FrozenMassDawg::save(const string & path) const {
+    ofstream out(path, ios::binary | ios::trunc);
+    if (!out.is_open()) throw runtime_error("could not open " + path + " for writing");
+
+    out.write(this->base, this->length);
+    out.close();
+    if (out.fail()) throw runtime_error("could not write " + path);
+}
+
+/**
+ * Map a file written by save. Nothing is copied or rebuilt, the graph is
+ * searched straight out of the mapped file. Unless verify is false, every
+ * offset, child and kmer of the file is checked first, which reads the whole
+ * file but stops a corrupt one from being read out of bounds by a search
+ *
+ * @param path      string      the file to load
+ * @param verify    bool        check the arrays of the file. Only files that are trusted should skip it
+ *
+ * @return FrozenMassDawg *     the loaded graph
+ *
+ * @throws runtime_error    if the file can not be mapped, is not a graph, was
+ *                          written with a different format version or number of charges
+ *                          or (when verified) is corrupt
+*/
+FrozenMassDawg * FrozenMassDawg::load(const string & path, bool verify){
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) throw runtime_error("could not open " + path);
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size < (off_t)sizeof(FrozenFileHeader)){
+        close(fd);
+        throw runtime_error(path + " is not a saved FrozenMassDawg");
+    }
+
+    void * mapping = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    // the mapping stays valid after the file is closed
+    close(fd);
+    if (mapping == MAP_FAILED) throw runtime_error("could not map " + path);
+
+    // a graph saved by a build with another number of charges is otherwise fine,
+    // so say so instead of calling it corrupt
+    FrozenFileHeader header;
+    memcpy(&header, mapping, sizeof(header));
+    if (memcmp(header.magic, FROZEN_MAGIC, sizeof(header.magic)) == 0 && header.version == FROZEN_FORMAT_VERSION
+    && header.byteOrder == FROZEN_BYTE_ORDER && header.charges != MASSDAWG_CHARGES){
+        munmap(mapping, (size_t)info.st_size);
+        throw runtime_error(path + " was saved with " + to_string(header.charges) + " charges but this build has "
+            + to_string(MASSDAWG_CHARGES) + ", build with MASSDAWG_CHARGES=" + to_string(header.charges) + " to load it");
+    }
+
+    FrozenMassDawg * frozen = new FrozenMassDawg();
+    frozen->base = (const char *)mapping;
+    frozen->length = (size_t)info.st_size;
+    frozen->mapped = true;
+
+    if (!frozen->attach(frozen->base, frozen->length, verify)){
+        delete frozen;
+        throw runtime_error(path + " is corrupt or not a saved FrozenMassDawg of format version " + to_string(FROZEN_FORMAT_VERSION)
+            + " with " + to_string(MASSDAWG_CHARGES) + " charges");
+    }
+    return frozen;
+}
+
+/**
+ * Search for the input sequence while allowing for up to gapAllowances
+ * before the search returns however deep it is in the graph
+ *
+ * @param sequence      vector<float>   the sequence to search
+ * @param gapAllowance  int             The number of gaps to allow in the search
+ * @param ppmTol        int             the tolerance in parts per million to accept when searching
+ * @param stats         SearchStats *   counters to fill in, only when built with MASSDAWG_SEARCH_STATS
+ *
+ * @return vector<string>               All kmers that we found in the search
+*/
+vector<string> FrozenMassDawg::fuzzySearch(const vector<float> & sequence, int gapAllowance, int ppmTol, SearchStats * stats) const {
+    return this->fuzzySearch(sequence.data(), (int)sequence.size(), gapAllowance, ppmTol, stats);
+}
+
+/**
+ * Same as fuzzySearch, for a sequence in an array of masses
+ *
+ * @param sequence      const float *   the sequence to search
+ * @param length        int             the number of masses in sequence
+ * @param gapAllowance  int             The number of gaps to allow in the search
+ * @param ppmTol        int             the tolerance in parts per million to accept when searching
+ * @param stats         SearchStats *   counters to fill in, only when built with MASSDAWG_SEARCH_STATS
+ *
+ * @return vector<string>               All kmers that we found in the search
+*/
+vector<string> FrozenMassDawg::fuzzySearch(const float * sequence, int length, int gapAllowance, int ppmTol, SearchStats * stats) const {
+    return fuzzySearchGraph(*this, sequence, length, gapAllowance, ppmTol, stats);
+}
+
+/**
+ * Same as fuzzySearch, but remembers the results of every node for the peaks
+ * it was reached with, so a node shared by many paths is searched under once
+ * for each state it is reached in
+ *
+ * @param sequence      vector<float>   the sequence to search
+ * @param gapAllowance  int             The number of gaps to allow in the search
+ * @param ppmTol        int             the tolerance in parts per million to accept when searching
+ * @param stats         SearchStats *   counters to fill in, only when built with MASSDAWG_SEARCH_STATS
+ *
+ * @return vector<string>               the same kmers in the same order as fuzzySearch
+*/
+vector<string> FrozenMassDawg::memoizedFuzzySearch(const vector<float> & sequence, int gapAllowance, int ppmTol, SearchStats * stats) const {
+    return this->memoizedFuzzySearch(sequence.data(), (int)sequence.size(), gapAllowance, ppmTol, stats);
+}
+
+/**
+ * Same as memoizedFuzzySearch, for a sequence in an array of masses
+ *
+ * @param sequence      const float *   the sequence to search
+ * @param length        int             the number of masses in sequence
+ * @param gapAllowance  int             The number of gaps to allow in the search
+ * @param ppmTol        int             the tolerance in parts per million to accept when searching
+ * @param stats         SearchStats *   counters to fill in, only when built with MASSDAWG_SEARCH_STATS
+ *
+ * @return vector<string>               the same kmers in the same order as fuzzySearch
+*/
+vector<string> FrozenMassDawg::memoizedFuzzySearch(const float * sequence, int length, int gapAllowance, int ppmTol, SearchStats * stats) const {
+    return fuzzySearchGraph(*this, sequence, length, gapAllowance, ppmTol, stats, true);
+}
+
+/**
+ * Fuzzy search many spectra at once over a pool of threads.
+ *
+ * @param spectra       vector<vector<float>>   the sequences to search
+ * @param gapAllowance  int                     The number of gaps to allow in the search
+ * @param ppmTol        int                     the tolerance in parts per million to accept when searching
+ * @param threads       int                     the number of threads to use. If < 1, one per core is used
+ *
+ * @return vector<vector<string>>   the kmers found for each spectrum, in the same order as spectra
+*/
+vector<vector<string> > FrozenMassDawg::batchFuzzySearch(const vector<vector<float> > & spectra, int gapAllowance, int ppmTol, int threads) const {
+    return batchFuzzySearchGraph(*this, spectra, gapAllowance, ppmTol, threads);
+}
+
+/**
+ * A search with no gaps allowed
+ *
+ * @param sequence       vector<float>   the sequence to search
+ * @param ppmTol         int             the tolerance in parts per million to accept when searching
+ * @param stats          SearchStats *   counters to fill in, only when built with MASSDAWG_SEARCH_STATS
+ *
+ * @return vector<string>                All kmers that we found in the search
+*/
+vector<string> FrozenMassDawg::search(const vector<float> & sequence, int ppmTol, SearchStats * stats) const {
+    return this->search(sequence.data(), (int)sequence.size(), ppmTol, stats);
+}
+
+/**
+ * Same as search, for a sequence in an array of masses
+ *
+ * @param sequence       const float *   the sequence to search
+ * @param length         int             the number of masses in sequence
+ * @param ppmTol         int             the tolerance in parts per million to accept when searching
+ * @param stats          SearchStats *   counters to fill in, only when built with MASSDAWG_SEARCH_STATS
+ *
+ * @return vector<string>                All kmers that we found in the search
+*/
+vector<string> FrozenMassDawg::search(const float * sequence, int length, int ppmTol, SearchStats * stats) const {
+    return searchGraph(*this, sequence, length, ppmTol, stats);
+}
+
+/**
+ * Search like fuzzySearch, scoring every path by the masses it matches (or
+ * the sum of their intensities) and returning only the k best kmers. Branches
+ * that can not beat the kth best kmer found so far are not searched
+ *
+ * @param sequence      vector<float>   the sequence to search
+ * @param k             int             the number of kmers to return
+ * @param gapAllowance  int             The number of gaps to allow in the search
+ * @param ppmTol        int             the tolerance in parts per million to accept when searching
+ * @param intensities   vector<float>   the intensity of each mass in sequence. If empty, matched masses are counted
+ * @param stats         SearchStats *   counters to fill in, only when built with MASSDAWG_SEARCH_STATS
+ *
+ * @return vector<ScoredKmer>           up to k kmers, best score first
+ *
+ * @throws invalid_argument    if intensities is not empty or the length of sequence, or has a negative intensity
+*/
+vector<ScoredKmer> FrozenMassDawg::topKSearch(const vector<float> & sequence, int k, int gapAllowance, int ppmTol, 
+    const vector<float> & intensities, SearchStats * stats) const {
+    if (!intensities.empty() && intensities.size() != sequence.size()) throw invalid_argument("intensities must be empty or the same length as the sequence");
+
+    return this->topKSearch(sequence.data(), intensities.empty() ? nullptr : intensities.data(), (int)sequence.size(), k, gapAllowance, ppmTol, stats);
+}
+
+/**
+ * Same as topKSearch, for a sequence in an array of masses
+ *
+ * @param sequence      const float *   the sequence to search
+ * @param intensities   const float *   the intensity of each mass in sequence, or null to count matched masses
+ * @param length        int             the number of masses in sequence
+ * @param k             int             the number of kmers to return
+ * @param gapAllowance  int             The number of gaps to allow in the search
+ * @param ppmTol        int             the tolerance in parts per million to accept when searching
+ * @param stats         SearchStats *   counters to fill in, only when built with MASSDAWG_SEARCH_STATS
+ *
+ * @return vector<ScoredKmer>           up to k kmers, best score first
+ *
+ * @throws invalid_argument    if an intensity is negative
+*/
+vector<ScoredKmer> FrozenMassDawg::topKSearch(const float * sequence, const float * intensities, int length, int k, int gapAllowance, int ppmTol, 
+    SearchStats * stats) const {
+    return topKSearchGraph(*this, sequence, intensities, length, k, gapAllowance, ppmTol, stats);
+}
+
+/**
+ * Precompute the tolerance windows of every node for one ppm tolerance.
+ * Searches with that tolerance read the windows instead of computing them,
+ * any other tolerance is computed as before. Must not be called while the
+ * graph is being searched
+ *
+ * @param ppmTol    int     the tolerance in parts per million to precompute, or < 0 to drop the windows
+*/
+void FrozenMassDawg::bindTolerance(int ppmTol){
+    this->boundWindows.clear();
+    this->boundPpm = -1;
+    if (ppmTol < 0){
+        this->boundWindows.shrink_to_fit();
+        return;
+    }
+
+    // computed the same way a search computes them, so results do not change
+    this->boundWindows.resize(this->nodes);
+    for (Node node = 0; node < this->nodes; node++){
+        this->boundWindows[node] = massWindows(this->masses[node], ppmTol);
+    }
+    this->boundPpm = ppmTol;
+}
+
+/**
+ * Get the kmer string for a kmer id
+ *
+ * @param id    uint32_t    the id of the kmer
+ *
+ * @return string   the kmer
+*/
+string FrozenMassDawg::kmer(uint32_t id) const {
+    return string(this->kmerChars + this->kmerStarts[id], this->kmerLengths[id]);
+}
+
+/**
+ * Add the kmers of a node to the output
+ *
+ * @param node      Node                the node whose kmers we want
+ * @param out       vector<string> &    where the kmers are added
+*/
+void FrozenMassDawg::appendKmers(Node node, vector<string> & out) const {
+    for (uint32_t i = this->kmerOffsets[node]; i < this->kmerOffsets[node + 1]; i++){
+        out.push_back(this->kmer(this->kmerIds[i]));
+    }
+}
+
+
+
+/*******************Private methods*******************/
+
+// an empty graph for load to fill in
+FrozenMassDawg::FrozenMassDawg(){
+    this->nodes = this->edges = this->kmers = this->longestKmer = 0;
+    this->base = nullptr;
+    this->length = 0;
+    this->mapped = false;
+
+    this->masses = nullptr;
+    this->childOffsets = this->children = this->kmerOffsets = this->kmerIds = nullptr;
+    this->kmerStarts = this->kmerLengths = nullptr;
+    this->kmerChars = nullptr;
+    this->boundPpm = -1;
+}
+
+/**
+ * Point the arrays into a buffer in the file layout
+ *
+ * @param base      const char *    the start of the buffer
+ * @param length    size_t          the size of the buffer in bytes
+ * @param verify    bool            check every array with consistent
+ *
+ * @return bool     False if the buffer is not a graph of this format version and number of charges
+ *                  or fails the checks, True otherwise
+*/
+bool FrozenMassDawg::attach(const char * base, size_t length, bool verify){
+    if (length < sizeof(FrozenFileHeader)) return false;
+
+    FrozenFileHeader header;
+    memcpy(&header, base, sizeof(header));
+
+    if (memcmp(header.magic, FROZEN_MAGIC, sizeof(header.magic)) != 0
+    || header.version != FROZEN_FORMAT_VERSION
+    || header.byteOrder != FROZEN_BYTE_ORDER
+    || header.charges != MASSDAWG_CHARGES
+    || header.nodes == 0) return false;
+
+    // every count has to fit in the buffer before the layout is summed up, or a
+    // huge one wraps the layout around to a length that looks like it fits
+    if (header.chars > length
+    || (uint64_t)header.nodes * header.charges * sizeof(FixedMass) > length
+    || (uint64_t)header.edges * sizeof(uint32_t) > length
+    || (uint64_t)header.kmerIds * sizeof(uint32_t) > length
+    || (uint64_t)header.kmers * sizeof(uint32_t) > length) return false;
+
+    FrozenLayout layout(header);
+    if (layout.length > length) return false;
+
+    this->nodes = header.nodes;
+    this->edges = header.edges;
+    this->kmers = header.kmers;
+    this->longestKmer = header.longestKmer;
+
+    this->masses = (const NodeMasses *)(base + layout.masses);
+    this->childOffsets = (const uint32_t *)(base + layout.childOffsets);
+    this->children = (const Node *)(base + layout.children);
+    this->kmerOffsets = (const uint32_t *)(base + layout.kmerOffsets);
+    this->kmerIds = (const uint32_t *)(base + layout.kmerIds);
+    this->kmerStarts = (const uint32_t *)(base + layout.kmerStarts);
+    this->kmerLengths = (const uint32_t *)(base + layout.kmerLengths);
+    this->kmerChars = base + layout.kmerChars;
+
+    // the offset arrays have to end at the arrays they index into
+    if (this->childOffsets[this->nodes] != this->edges || this->kmerOffsets[this->nodes] != header.kmerIds) return false;
+    return !verify || this->consistent(header.chars);
+}
+
+/**
+ * Check that the attached arrays can be searched without reading out of bounds
+ *
+ * @param chars     uint64_t    the number of kmer characters in the buffer
+ *
+ * @return bool     True if offsets never decrease, every child, kmer id and kmer is
+ *                  in bounds, children are sorted by their masses, no kmer is longer
+ *                  than longestKmer and no path leads back to a node on it, False otherwise
+*/
+bool FrozenMassDawg::consistent(uint64_t chars) const {
+    // with the last offsets already checked, offsets that never decrease keep every range in its array
+    for (uint32_t i = 0; i < this->nodes; i++){
+        if (this->childOffsets[i] > this->childOffsets[i + 1] || this->kmerOffsets[i] > this->kmerOffsets[i + 1]) return false;
+    }
+    for (uint32_t i = 0; i < this->edges; i++){
+        if (this->children[i] >= this->nodes) return false;
+    }
+    // searches stop scanning the children once they pass a window, so unsorted
+    // children would be missed instead of read out of bounds
+    for (Node node = 0; node < this->nodes; node++){
+        for (int c = 1; c < this->childCount(node); c++){
+            if (this->masses[this->child(node, c)] < this->masses[this->child(node, c - 1)]) return false;
+        }
+    }
+    for (uint32_t i = 0; i < this->kmerOffsets[this->nodes]; i++){
+        if (this->kmerIds[i] >= this->kmers) return false;
+    }
+    for (uint32_t id = 0; id < this->kmers; id++){
+        if ((uint64_t)this->kmerStarts[id] + this->kmerLengths[id] > chars || this->kmerLengths[id] > this->longestKmer) return false;
+    }
+
+    // searches follow every path down, so one that loops would never end. Take away
+    // nodes with no parents left until there are none, which leaves every node of a loop
+    vector<uint32_t> parents(this->nodes, 0);
+    for (uint32_t i = 0; i < this->edges; i++) parents[this->children[i]] ++;
+
+    vector<Node> orphans;
+    for (Node node = 0; node < this->nodes; node++){
+        if (parents[node] == 0) orphans.push_back(node);
+    }
+
+    uint32_t taken = 0;
+    while (!orphans.empty()){
+        Node node = orphans.back();
+        orphans.pop_back();
+        taken ++;
+
+        for (int c = 0; c < this->childCount(node); c++){
+            if (-- parents[this->child(node, c)] == 0) orphans.push_back(this->child(node, c));
+        }
+    }
+    return taken == this->nodes;
+}
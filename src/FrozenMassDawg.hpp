@@ -0,0 +1,297 @@
+#ifndef FROZENMASSDAWG_H
+#define FROZENMASSDAWG_H
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+#include "MassDawg.hpp"
+#include "SearchStats.hpp"
+
+using namespace std;
+
+// the version of the file format written by save. Files of other versions are not loaded
+#define FROZEN_FORMAT_VERSION   4
+
+/**
+ * An immutable copy of a finished MassDawg. Every node is stored by index in
+ * contiguous arrays (masses, child offset ranges and kmer id ranges) so searches
+ * walk flat memory instead of chasing MassDawgNode pointers. Node 0 is the root.
+ *
+ * The arrays are kept in one buffer laid out exactly like the file written by
+ * save, so a saved graph can be mmaped by load and searched in place.
+*/
+class FrozenMassDawg {
+public:
+    typedef uint32_t Node;
+
+    /**
+     * Finish the dawg and compile it into the flat layout. The dawg is not
+     * changed after the final minimization and can be deleted afterwards
+     *
+     * @param dawg      MassDawg *      the graph to freeze
+    */
+    FrozenMassDawg(MassDawg * dawg);
+
+    // unmaps the file of a loaded graph
+    ~FrozenMassDawg();
+
+    // the arrays point into the graph's own buffer or mapping, so it can not be copied
+    FrozenMassDawg(const FrozenMassDawg &) = delete;
+    FrozenMassDawg & operator=(const FrozenMassDawg &) = delete;
+
+    /**
+     * Write the graph to a file that load can map
+     *
+     * @param path      string      where to write the graph
+     *
+     * @throws runtime_error    if the file can not be written
+    */
+    void save(const string & path) const;
+
+    /**
+     * Map a file written by save. Nothing is copied or rebuilt, the graph is
+     * searched straight out of the mapped file. Unless verify is false, every
+     * offset, child and kmer of the file is checked first, which reads the whole
+     * file but stops a corrupt one from being read out of bounds by a search
+     *
+     * @param path      string      the file to load
+     * @param verify    bool        check the arrays of the file. Only files that are trusted should skip it
+     *
+     * @return FrozenMassDawg *     the loaded graph
+     *
+     * @throws runtime_error    if the file can not be mapped, is not a graph, was
+     *                          written with a different format version or number of charges
+     *                          or (when verified) is corrupt
+    */
+    static FrozenMassDawg * load(const string & path, bool verify = true);
+
+    /**
+     * Search for the input sequence while allowing for up to gapAllowances
+     * before the search returns however deep it is in the graph
+     *
+     * @param sequence      vector<float>   the sequence to search
+     * @param gapAllowance  int             The number of gaps to allow in the search
+     * @param ppmTol        int             the tolerance in parts per million to accept when searching
+     * @param stats         SearchStats *   counters to fill in, only when built with MASSDAWG_SEARCH_STATS
+     *
+     * @return vector<string>               All kmers that we found in the search
+    */
+    vector<string> fuzzySearch(const vector<float> & sequence, int gapAllowance, int ppmTol, SearchStats * stats = nullptr) const;
+
+    /**
+     * Same as fuzzySearch, for a sequence in an array of masses
+     *
+     * @param sequence      const float *   the sequence to search
+     * @param length        int             the number of masses in sequence
+     * @param gapAllowance  int             The number of gaps to allow in the search
+     * @param ppmTol        int             the tolerance in parts per million to accept when searching
+     * @param stats         SearchStats *   counters to fill in, only when built with MASSDAWG_SEARCH_STATS
+     *
+     * @return vector<string>               All kmers that we found in the search
+    */
+    vector<string> fuzzySearch(const float * sequence, int length, int gapAllowance, int ppmTol, SearchStats * stats = nullptr) const;
+
+    /**
+     * Same as fuzzySearch, but remembers the results of every node for the peaks
+     * it was reached with, so a node shared by many paths is searched under once
+     * for each state it is reached in
+     *
+     * @param sequence      vector<float>   the sequence to search
+     * @param gapAllowance  int             The number of gaps to allow in the search
+     * @param ppmTol        int             the tolerance in parts per million to accept when searching
+     * @param stats         SearchStats *   counters to fill in, only when built with MASSDAWG_SEARCH_STATS
+     *
+     * @return vector<string>               the same kmers in the same order as fuzzySearch
+    */
+    vector<string> memoizedFuzzySearch(const vector<float> & sequence, int gapAllowance, int ppmTol, SearchStats * stats = nullptr) const;
+
+    /**
+     * Same as memoizedFuzzySearch, for a sequence in an array of masses
+     *
+     * @param sequence      const float *   the sequence to search
+     * @param length        int             the number of masses in sequence
+     * @param gapAllowance  int             The number of gaps to allow in the search
+     * @param ppmTol        int             the tolerance in parts per million to accept when searching
+     * @param stats         SearchStats *   counters to fill in, only when built with MASSDAWG_SEARCH_STATS
+     *
+     * @return vector<string>               the same kmers in the same order as fuzzySearch
+    */
+    vector<string> memoizedFuzzySearch(const float * sequence, int length, int gapAllowance, int ppmTol, SearchStats * stats = nullptr) const;
+
+    /**
+     * Fuzzy search many spectra at once over a pool of threads.
+     *
+     * @param spectra       vector<vector<float>>   the sequences to search
+     * @param gapAllowance  int                     The number of gaps to allow in the search
+     * @param ppmTol        int                     the tolerance in parts per million to accept when searching
+     * @param threads       int                     the number of threads to use. If < 1, one per core is used
+     *
+     * @return vector<vector<string>>   the kmers found for each spectrum, in the same order as spectra
+    */
+    vector<vector<string> > batchFuzzySearch(const vector<vector<float> > & spectra, int gapAllowance, int ppmTol, int threads) const;
+
+    /**
+     * A search with no gaps allowed
+     *
+     * @param sequence       vector<float>   the sequence to search
+     * @param ppmTol         int             the tolerance in parts per million to accept when searching
+     * @param stats          SearchStats *   counters to fill in, only when built with MASSDAWG_SEARCH_STATS
+     *
+     * @return vector<string>                All kmers that we found in the search
+    */
+    vector<string> search(const vector<float> & sequence, int ppmTol, SearchStats * stats = nullptr) const;
+
+    /**
+     * Same as search, for a sequence in an array of masses
+     *
+     * @param sequence       const float *   the sequence to search
+     * @param length         int             the number of masses in sequence
+     * @param ppmTol         int             the tolerance in parts per million to accept when searching
+     * @param stats          SearchStats *   counters to fill in, only when built with MASSDAWG_SEARCH_STATS
+     *
+     * @return vector<string>                All kmers that we found in the search
+    */
+    vector<string> search(const float * sequence, int length, int ppmTol, SearchStats * stats = nullptr) const;
+
+    /**
+     * Search like fuzzySearch, scoring every path by the masses it matches (or
+     * the sum of their intensities) and returning only the k best kmers. Branches
+     * that can not beat the kth best kmer found so far are not searched
+     *
+     * @param sequence      vector<float>   the sequence to search
+     * @param k             int             the number of kmers to return
+     * @param gapAllowance  int             The number of gaps to allow in the search
+     * @param ppmTol        int             the tolerance in parts per million to accept when searching
+     * @param intensities   vector<float>   the intensity of each mass in sequence. If empty, matched masses are counted
+     * @param stats         SearchStats *   counters to fill in, only when built with MASSDAWG_SEARCH_STATS
+     *
+     * @return vector<ScoredKmer>           up to k kmers, best score first
+     *
+     * @throws invalid_argument    if intensities is not empty or the length of sequence, or has a negative intensity
+    */
+    vector<ScoredKmer> topKSearch(const vector<float> & sequence, int k, int gapAllowance, int ppmTol, 
+        const vector<float> & intensities = vector<float>(), SearchStats * stats = nullptr) const;
+
+    /**
+     * Same as topKSearch, for a sequence in an array of masses
+     *
+     * @param sequence      const float *   the sequence to search
+     * @param intensities   const float *   the intensity of each mass in sequence, or null to count matched masses
+     * @param length        int             the number of masses in sequence
+     * @param k             int             the number of kmers to return
+     * @param gapAllowance  int             The number of gaps to allow in the search
+     * @param ppmTol        int             the tolerance in parts per million to accept when searching
+     * @param stats         SearchStats *   counters to fill in, only when built with MASSDAWG_SEARCH_STATS
+     *
+     * @return vector<ScoredKmer>           up to k kmers, best score first
+     *
+     * @throws invalid_argument    if an intensity is negative
+    */
+    vector<ScoredKmer> topKSearch(const float * sequence, const float * intensities, int length, int k, int gapAllowance, int ppmTol, 
+        SearchStats * stats = nullptr) const;
+
+    /**
+     * Precompute the tolerance windows of every node for one ppm tolerance.
+     * Searches with that tolerance read the windows instead of computing them,
+     * any other tolerance is computed as before. Must not be called while the
+     * graph is being searched
+     *
+     * @param ppmTol    int     the tolerance in parts per million to precompute, or < 0 to drop the windows
+    */
+    void bindTolerance(int ppmTol);
+
+    // the tolerance bound by bindTolerance, or -1 if there is none
+    int boundTolerance() const { return this->boundPpm; }
+
+    // number of nodes (including the root), edges and distinct kmers in the graph
+    int nodeCount() const { return (int)this->nodes; }
+    int edgeCount() const { return (int)this->edges; }
+    int kmerCount() const { return (int)this->kmers; }
+
+    /**
+     * Get the kmer string for a kmer id
+     *
+     * @param id    uint32_t    the id of the kmer
+     *
+     * @return string   the kmer
+    */
+    string kmer(uint32_t id) const;
+
+    // graph interface used by GraphSearch.hpp
+    Node root() const { return 0; }
+    int childCount(Node node) const { return (int)(this->childOffsets[node + 1] - this->childOffsets[node]); }
+    Node child(Node node, int i) const { return this->children[this->childOffsets[node] + i]; }
+    FixedMass mass(Node node, int charge) const { return this->masses[node][charge - 1]; }
+    MassWindows windows(Node node, int ppmTol) const {
+        if (ppmTol == this->boundPpm && ppmTol >= 0) return this->boundWindows[node];
+        return massWindows(this->masses[node], ppmTol);
+    }
+    void appendKmers(Node node, vector<string> & out) const;
+    int maxDepth() const { return (int)this->longestKmer; }
+
+private:
+    uint32_t nodes;
+    uint32_t edges;
+    uint32_t kmers;
+    // the length of the longest kmer, which is as deep as any node is
+    uint32_t longestKmer;
+
+    // the file layout of a graph compiled in this process
+    vector<uint64_t> storage;
+    // the start and size in bytes of the layout, in storage or in the mapped file
+    const char * base;
+    size_t length;
+    // true if base is a mapped file that has to be unmapped
+    bool mapped;
+
+    // masses of each node at every charge
+    const NodeMasses * masses;
+
+    // children of node i are children[childOffsets[i], childOffsets[i + 1])
+    const uint32_t * childOffsets;
+    const Node * children;
+
+    // kmers of node i are kmerIds[kmerOffsets[i], kmerOffsets[i + 1])
+    const uint32_t * kmerOffsets;
+    const uint32_t * kmerIds;
+
+    // kmer with id j is kmerChars[kmerStarts[j], kmerStarts[j] + kmerLengths[j]),
+    // the same ids as the KmerTable of the graph that was frozen
+    const uint32_t * kmerStarts;
+    const uint32_t * kmerLengths;
+    const char * kmerChars;
+
+    // the windows of every node at boundPpm, which is -1 when no tolerance is bound.
+    // They are not saved, a loaded graph has to be bound again
+    int boundPpm;
+    vector<MassWindows> boundWindows;
+
+    // an empty graph for load to fill in
+    FrozenMassDawg();
+
+    /**
+     * Point the arrays into a buffer in the file layout
+     *
+     * @param base      const char *    the start of the buffer
+     * @param length    size_t          the size of the buffer in bytes
+     * @param verify    bool            check every array with consistent
+     *
+     * @return bool     False if the buffer is not a graph of this format version and number of charges
+     *                  or fails the checks, True otherwise
+    */
+    bool attach(const char * base, size_t length, bool verify);
+
+    /**
+     * Check that the attached arrays can be searched without reading out of bounds
+     *
+     * @param chars     uint64_t    the number of kmer characters in the buffer
+     *
+     * @return bool     True if offsets never decrease, every child, kmer id and kmer is
+     *                  in bounds, children are sorted by their masses, no kmer is longer
+     *                  than longestKmer and no path leads back to a node on it, False otherwise
+    */
+    bool consistent(uint64_t chars) const;
+};
+#endif
@@ -0,0 +1,939 @@
+#ifndef GRAPHSEARCH_H
+#define GRAPHSEARCH_H
+
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <thread>
+#include <atomic>
+#include <map>
+#include <set>
+#include <stdexcept>
+#include <stdint.h>
+#include <cstring>
+
+#include "utils.hpp"
+#include "SearchStats.hpp"
+#include "ScoredKmer.hpp"
+#include "WindowKernel.hpp"
+
+using namespace std;
+
+/**
+ * Search routines shared by every graph representation (the pointer based
+ * MassDawg and the flat FrozenMassDawg). A graph is anything that provides
+ *
+ *  Node                                    a cheap handle to a node
+ *  Node root()                             the root of the graph
+ *  int childCount(Node node)               the number of outgoing edges of node
+ *  Node child(Node node, int i)            the ith child of node, sorted by its masses, singly charged first
+ *  FixedMass mass(Node node, int charge)   the mass of node at a charge from 1 to MASSDAWG_CHARGES
+ *  MassWindows windows(Node node, int ppmTol)  the tolerance windows around the masses of node
+ *  void appendKmers(Node node, vector<string> & out)   add the kmers of node to out
+ *  int maxDepth()                          the most nodes on any path from the root, the longest kmer
+ *
+ * so both representations are guaranteed to return the same results. None of
+ * the routines change the graph, so one graph can be searched from many threads.
+ * Every loop over the windows of a node runs to MassWindows::charges, which is
+ * known when the routines are compiled, so each build gets loops unrolled for
+ * exactly the charges it keeps.
+*/
+
+/**
+ * Convert the masses of a spectrum to fixed point, in the order given. Masses
+ * too large or small for a FixedMass are clamped and can match nothing in a graph
+ *
+ * @param sequence      const float *       the masses of the spectrum
+ * @param length        int                 the number of masses
+ * @param out           vector<FixedMass> & filled with the converted masses
+*/
+inline void fixedPeaks(const float * sequence, int length, vector<FixedMass> & out){
+    out.resize(length);
+    for (int i = 0; i < length; i++) out[i] = toFixedMass(sequence[i]);
+}
+
+/**
+ * Find the first mass in a sorted sequence that is not below lowerBound
+ *
+ * @param sorted        vector<FixedMass>   masses sorted smallest to largest
+ * @param lowerBound    FixedMass           the smallest mass wanted
+ *
+ * @return int      the index of the first mass >= lowerBound, or sorted.size() if there is none
+*/
+inline int windowStart(const vector<FixedMass> & sorted, FixedMass lowerBound){
+    return countBelow(sorted.data(), (int)sorted.size(), lowerBound);
+}
+
+/**
+ * Check if any mass in a sorted sequence falls within a window
+ *
+ * @param sorted        vector<FixedMass>   masses sorted smallest to largest
+ * @param lowerBound    FixedMass           the lower bound of the window
+ * @param upperBound    FixedMass           the upper bound of the window
+ *
+ * @return bool     True if a mass is in [lowerBound, upperBound]
+*/
+inline bool anyInWindow(const vector<FixedMass> & sorted, FixedMass lowerBound, FixedMass upperBound){
+    WindowMatches matches = findWindow(sorted.data(), (int)sorted.size(), lowerBound, upperBound);
+    return matches.start < matches.end;
+}
+
+/**
+ * The peaks of a spectrum used up by the nodes on the current path of a search,
+ * one bit per peak in 64 bit words. A window of sorted peaks is a run of bits,
+ * so consuming it is a mask and an OR per word it touches (one, nearly always),
+ * and each word changed is logged with the bits it gained so backing out of a
+ * node is an AND NOT per entry. A hash of the bits is kept up to date as they
+ * change so the state can key a memo without reading every word.
+*/
+class PeakMask {
+public:
+    // bits gained by one word
+    struct Change {
+        int word;
+        uint64_t bits;
+    };
+
+    // bit i of words[i / 64] is set when peak i is consumed
+    vector<uint64_t> words;
+    // every change since the last reset, oldest first
+    vector<Change> log;
+    // the sum of each word times its own odd constant. Bits gained and lost never
+    // overlap within a word, so the sum can be added to and taken from per change
+    uint64_t hash;
+
+    // clear the mask for a spectrum of length peaks
+    void reset(int length){
+        this->words.assign((length + 63) / 64, 0);
+        this->log.clear();
+        this->hash = 0;
+    }
+
+    // the constant word is multiplied by in hash
+    static uint64_t wordKey(int word){
+        return (2 * (uint64_t)word + 1) * 0x9e3779b97f4a7c15ULL;
+    }
+
+    // true if peak i is consumed
+    bool test(int i) const {
+        return (this->words[i >> 6] >> (i & 63)) & 1;
+    }
+
+    // the position in the log to release back to
+    int mark() const {
+        return (int)this->log.size();
+    }
+
+    /**
+     * Consume the peaks in [first, last) that are not consumed yet
+     *
+     * @param first     int     the index of the first peak
+     * @param last      int     one past the index of the last peak
+     *
+     * @return int      the number of peaks newly consumed
+    */
+    int consume(int first, int last){
+        int count = 0;
+        while (first < last){
+            int word = first >> 6;
+            int end = min(last, (word + 1) << 6);
+
+            // the bits first through end - 1 of this word
+            int high = end - (word << 6);
+            uint64_t run = (high == 64 ? ~(uint64_t)0 : ((uint64_t)1 << high) - 1) & ~(((uint64_t)1 << (first & 63)) - 1);
+            uint64_t fresh = run & ~this->words[word];
+
+            if (fresh){
+                this->words[word] |= fresh;
+                this->hash += fresh * wordKey(word);
+                Change change;
+                change.word = word;
+                change.bits = fresh;
+                this->log.push_back(change);
+                count += __builtin_popcountll(fresh);
+            }
+            first = end;
+        }
+        return count;
+    }
+
+    /**
+     * Give back every peak consumed since mark
+     *
+     * @param mark      int     the log position from mark()
+     *
+     * @return int      the number of peaks given back
+    */
+    int release(int mark){
+        int count = 0;
+        for (int i = mark; i < (int)this->log.size(); i++){
+            this->words[this->log[i].word] &= ~this->log[i].bits;
+            this->hash -= this->log[i].bits * wordKey(this->log[i].word);
+            count += __builtin_popcountll(this->log[i].bits);
+        }
+        this->log.resize(mark);
+        return count;
+    }
+};
+
+// a value of a node handle to hash, for graphs whose nodes are indices
+inline uint64_t nodeKey(uint32_t node){
+    return node;
+}
+
+// a value of a node handle to hash, for graphs whose nodes are pointers
+template <class T>
+inline uint64_t nodeKey(const T * node){
+    return (uint64_t)(uintptr_t)node;
+}
+
+/**
+ * Scratch space for fuzzy searches. Reusing one for many queries means a 
+ * query does not allocate anything once the buffers have grown to fit it.
+ * The spectrum is never copied: peaks used up by nodes on the current path 
+ * are set in the consumed bitmask, which logs them so they can be given back
+ * when the search backs out of a node.
+ *
+ * A memoized search also remembers the results each node added for the
+ * consumed peaks and gaps it was entered with. Everything a node adds depends
+ * only on those, so when minimizing merged the node into more than one path
+ * and another path reaches it in the same state, the results are copied
+ * instead of searching under the node again.
+*/
+template <class Node>
+class FuzzySearchScratch {
+public:
+    // one entry per node on the current path
+    struct Frame {
+        Node node;
+        // the next child to visit
+        int nextChild;
+        // gaps used by the path before and including this node
+        int gapBefore;
+        int gap;
+        // if this node matched a peak
+        bool massFound;
+        // the consumed mark from before this node's peaks
+        int logStart;
+        // the number of results before visiting the children
+        int resultMark;
+    };
+
+    // the peaks of the spectrum, sorted smallest to largest
+    vector<FixedMass> peaks;
+    // the peaks used by nodes on the current path
+    PeakMask consumed;
+    vector<Frame> stack;
+    // the number of peaks not yet consumed
+    int remaining;
+    // counters for the current search, or null
+    SearchStats * stats;
+
+    // the results a node added when it was entered with some consumed peaks and gaps
+    struct MemoEntry {
+        // the search that filled the entry, entries of earlier searches are empty
+        unsigned generation;
+        uint64_t hash;
+        Node node;
+        int gap;
+        // where a copy of the consumed words is in memoMasks
+        int maskOffset;
+        // the results the node added are results[resultStart, resultEnd)
+        int resultStart;
+        int resultEnd;
+    };
+
+    // if the current search uses the memo
+    bool memoize;
+    // open addressing with linear probing, sized to a power of 2
+    vector<MemoEntry> memo;
+    int memoCount;
+    unsigned generation;
+    vector<uint64_t> memoMasks;
+
+    FuzzySearchScratch(): remaining(0), stats(nullptr), memoize(false), memoCount(0), generation(0) {}
+
+    /**
+     * Reset for a new spectrum
+     *
+     * @param sequence  const float *   the masses of the spectrum
+     * @param length    int             the number of masses
+     * @param stats     SearchStats *   counters for the search, or null
+     * @param memoize   bool            if the search uses the memo
+    */
+    void reset(const float * sequence, int length, SearchStats * stats, bool memoize = false){
+        fixedPeaks(sequence, length, this->peaks);
+        sort(this->peaks.begin(), this->peaks.end());
+
+        this->consumed.reset(length);
+        this->stack.clear();
+        this->remaining = length;
+        this->stats = stats;
+
+        this->memoize = memoize;
+        if (!memoize) return;
+
+        // a new generation empties the memo without touching its entries
+        this->generation ++;
+        if (this->generation == 0 || this->memo.empty()){
+            this->memo.assign(max((size_t)256, this->memo.size()), MemoEntry());
+            this->generation = 1;
+        }
+        this->memoCount = 0;
+        this->memoMasks.clear();
+    }
+
+    // consume every peak in [lowerBound, upperBound] that has not been consumed yet, returning how many
+    int consumeWindow(FixedMass lowerBound, FixedMass upperBound){
+        WindowMatches matches = findWindow(this->peaks.data(), (int)this->peaks.size(), lowerBound, upperBound);
+        return this->consumed.consume(matches.start, matches.end);
+    }
+
+    // the memo hash of entering node with gap gaps used and the peaks consumed now
+    uint64_t memoHash(Node node, int gap) const {
+        return mixKey(this->consumed.hash ^ mixKey(nodeKey(node)) ^ ((uint64_t)gap << 56));
+    }
+
+    /**
+     * Find the memo entry of entering node with gap gaps used and the peaks consumed
+     * now, or the empty entry where it would go
+     *
+     * @param node      Node        the node entered
+     * @param gap       int         gaps used before the node
+     * @param hash      uint64_t    memoHash(node, gap)
+     *
+     * @return int      the index of the entry
+    */
+    int memoFind(Node node, int gap, uint64_t hash) const {
+        int mask = (int)this->memo.size() - 1;
+        int index = (int)(hash & mask);
+        int words = (int)this->consumed.words.size();
+
+        for (;; index = (index + 1) & mask){
+            const MemoEntry & entry = this->memo[index];
+            if (entry.generation != this->generation) return index;
+
+            if (entry.hash == hash && entry.node == node && entry.gap == gap
+            && (words == 0 || memcmp(&this->memoMasks[entry.maskOffset], this->consumed.words.data(), words * sizeof(uint64_t)) == 0)){
+                return index;
+            }
+        }
+    }
+
+    /**
+     * Add the results remembered for entering node in the current state, if there are any
+     *
+     * @param node      Node                the node entered
+     * @param gap       int                 gaps used before the node
+     * @param results   vector<string> &    where the results are added
+     *
+     * @return bool     True if the node was in the memo and its results were added
+    */
+    bool replay(Node node, int gap, vector<string> & results){
+        const MemoEntry & entry = this->memo[this->memoFind(node, gap, this->memoHash(node, gap))];
+        if (entry.generation != this->generation) return false;
+
+        // reserve first so results does not move while copying out of it
+        results.reserve(results.size() + (entry.resultEnd - entry.resultStart));
+        for (int i = entry.resultStart; i < entry.resultEnd; i++) results.push_back(results[i]);
+        return true;
+    }
+
+    /**
+     * Remember the results node added when it was entered in the current state
+     *
+     * @param node          Node    the node entered
+     * @param gap           int     gaps used before the node
+     * @param resultStart   int     the number of results before the node was entered
+     * @param resultEnd     int     the number of results after the node was searched
+    */
+    void remember(Node node, int gap, int resultStart, int resultEnd){
+        uint64_t hash = this->memoHash(node, gap);
+        MemoEntry & entry = this->memo[this->memoFind(node, gap, hash)];
+
+        entry.generation = this->generation;
+        entry.hash = hash;
+        entry.node = node;
+        entry.gap = gap;
+        entry.maskOffset = (int)this->memoMasks.size();
+        entry.resultStart = resultStart;
+        entry.resultEnd = resultEnd;
+        this->memoMasks.insert(this->memoMasks.end(), this->consumed.words.begin(), this->consumed.words.end());
+
+        // keep the table at most half full so probes stay short
+        this->memoCount ++;
+        if (this->memoCount * 2 > (int)this->memo.size()) this->growMemo();
+    }
+
+    // double the size of the memo and reinsert the entries of this search
+    void growMemo(){
+        vector<MemoEntry> old;
+        old.swap(this->memo);
+        this->memo.assign(old.size() * 2, MemoEntry());
+
+        int mask = (int)this->memo.size() - 1;
+        for (const MemoEntry & entry: old){
+            if (entry.generation != this->generation) continue;
+
+            int index = (int)(entry.hash & mask);
+            while (this->memo[index].generation == this->generation) index = (index + 1) & mask;
+            this->memo[index] = entry;
+        }
+    }
+
+};
+
+/**
+ * Visit a node in the fuzzy search. If the node can have children, a frame is
+ * pushed so its children are visited next, otherwise any results are added now
+ *
+ * @param graph         Graph                       The graph being searched
+ * @param node          Graph::Node                 The node to visit
+ * @param currentGap    int                         The number of gaps used before this node
+ * @param gapAllowance  int                         The total number of gaps to allow
+ * @param ppmTol        int                         the tolerance in parts per million to accept when searching
+ * @param scratch       FuzzySearchScratch &        the state of the search
+ * @param results       vector<string> &            where the kmers found are added
+*/
+template <class Graph>
+void fuzzySearchGraphEnter(const Graph & graph, typename Graph::Node node, int currentGap, 
+    int gapAllowance, int ppmTol, FuzzySearchScratch<typename Graph::Node> & scratch, vector<string> & results){
+
+    // BASE CASE: we're past our limit or every peak has been used
+    if ((gapAllowance - currentGap) < 0 || scratch.remaining == 0) return;
+
+    // another path already searched this node in the same state
+    if (scratch.memoize && scratch.replay(node, currentGap, results)){
+        SEARCH_STATS_ADD(scratch.stats, memoHits, 1);
+        return;
+    }
+
+    SEARCH_STATS_ADD(scratch.stats, nodesVisited, 1);
+    SEARCH_STATS_ADD(scratch.stats, toleranceChecks, MassWindows::charges);
+    SEARCH_STATS_MAX(scratch.stats, maxDepth, (int)scratch.stack.size() + 1);
+
+    // the range of the masses within this node at every charge
+    MassWindows windows = graph.windows(node, ppmTol);
+
+    // consume every remaining peak within any set of bounds. The peaks 
+    // are sorted, so each window is a binary search and a short scan
+    int logStart = scratch.consumed.mark();
+    int consumedHere = 0;
+    for (int z = 0; z < MassWindows::charges; z++) consumedHere += scratch.consumeWindow(windows.lower[z], windows.upper[z]);
+
+    bool massFound = consumedHere > 0;
+    scratch.remaining -= consumedHere;
+
+    // if we used up the sequence, this is as deep as we go
+    if (massFound && scratch.remaining == 0){
+        int resultStart = (int)results.size();
+        graph.appendKmers(node, results);
+
+        // give the peaks back for the rest of the search
+        scratch.remaining += scratch.consumed.release(logStart);
+        if (scratch.memoize) scratch.remember(node, currentGap, resultStart, (int)results.size());
+        return;
+    }
+
+    typename FuzzySearchScratch<typename Graph::Node>::Frame frame;
+    frame.node = node;
+    frame.nextChild = 0;
+    frame.gapBefore = currentGap;
+    frame.gap = currentGap + (massFound ? 0 : 1);
+    frame.massFound = massFound;
+    frame.logStart = logStart;
+    frame.resultMark = (int)results.size();
+    scratch.stack.push_back(frame);
+
+    SEARCH_STATS_ADD(scratch.stats, gapBranches, massFound ? 0 : 1);
+}
+
+/**
+ * Search for the input sequence while allowing for up to gapAllowances
+ * before the search returns however deep it is in the graph. Every branch 
+ * returns the kmers of the deepest node that matched a mass on it
+ *
+ * @param graph         Graph                       the graph to search
+ * @param sequence      const float *               the sequence to search
+ * @param length        int                         the number of masses in sequence
+ * @param gapAllowance  int                         The number of gaps to allow in the search
+ * @param ppmTol        int                         the tolerance in parts per million to accept when searching
+ * @param scratch       FuzzySearchScratch &        reusable space for the search
+ * @param results       vector<string> &            where the kmers found are added
+ * @param stats         SearchStats *               counters for the search, or null
+ * @param memoize       bool                        if nodes reached again in the same state reuse their results
+*/
+template <class Graph>
+void fuzzySearchGraph(const Graph & graph, const float * sequence, int length, int gapAllowance, int ppmTol, 
+    FuzzySearchScratch<typename Graph::Node> & scratch, vector<string> & results, SearchStats * stats = nullptr, bool memoize = false){
+
+    typedef typename Graph::Node Node;
+
+    scratch.reset(sequence, length, stats, memoize);
+    // results may already hold kmers, only count the ones this search adds
+    SEARCH_STATS_ADD(stats, resultsEmitted, -(long)results.size());
+
+    Node root = graph.root();
+    for (int r = 0; r < graph.childCount(root); r++){
+        fuzzySearchGraphEnter(graph, graph.child(root, r), 0, gapAllowance, ppmTol, scratch, results);
+
+        // depth first through everything under this child of the root
+        while (!scratch.stack.empty()){
+            typename FuzzySearchScratch<Node>::Frame & top = scratch.stack.back();
+
+            if (top.nextChild < graph.childCount(top.node)){
+                Node child = graph.child(top.node, top.nextChild);
+                top.nextChild ++;
+
+                // top may move when the stack grows, so nothing of it is used after this
+                fuzzySearchGraphEnter(graph, child, top.gap, gapAllowance, ppmTol, scratch, results);
+                continue;
+            }
+
+            // if no children had results and we found a mass, our kmers are the results
+            if (top.massFound && (int)results.size() == top.resultMark) graph.appendKmers(top.node, results);
+
+            // give back the peaks this node consumed
+            scratch.remaining += scratch.consumed.release(top.logStart);
+
+            // the peaks are as they were when the node was entered, and nothing
+            // was added to results before resultMark
+            if (scratch.memoize) scratch.remember(top.node, top.gapBefore, top.resultMark, (int)results.size());
+
+            scratch.stack.pop_back();
+        }
+    }
+
+    SEARCH_STATS_ADD(stats, resultsEmitted, (long)results.size());
+}
+
+/**
+ * Search for the input sequence while allowing for up to gapAllowances
+ * before the search returns however deep it is in the graph
+ *
+ * @param graph         Graph           the graph to search
+ * @param sequence      const float *   the sequence to search
+ * @param length        int             the number of masses in sequence
+ * @param gapAllowance  int             The number of gaps to allow in the search
+ * @param ppmTol        int             the tolerance in parts per million to accept when searching
+ * @param stats         SearchStats *   counters for the search, or null
+ * @param memoize       bool            if nodes reached again in the same state reuse their results
+ *
+ * @return vector<string>               All kmers that we found in the search
+*/
+template <class Graph>
+vector<string> fuzzySearchGraph(const Graph & graph, const float * sequence, int length, int gapAllowance, int ppmTol, 
+    SearchStats * stats = nullptr, bool memoize = false){
+
+    FuzzySearchScratch<typename Graph::Node> scratch;
+    vector<string> results;
+
+    fuzzySearchGraph(graph, sequence, length, gapAllowance, ppmTol, scratch, results, stats, memoize);
+    return results;
+}
+
+/**
+ * Fuzzy search many spectra at once, spread over a number of threads. Each
+ * thread reuses one scratch space for all of the spectra it takes
+ *
+ * @param graph         Graph                       the graph to search
+ * @param spectra       vector<vector<float>>       the sequences to search
+ * @param gapAllowance  int                         The number of gaps to allow in the search
+ * @param ppmTol        int                         the tolerance in parts per million to accept when searching
+ * @param threads       int                         the number of threads to use. If < 1, one per core is used
+ *
+ * @return vector<vector<string>>   the kmers found for each spectrum, in the same order as spectra
+*/
+template <class Graph>
+vector<vector<string> > batchFuzzySearchGraph(const Graph & graph, const vector<vector<float> > & spectra, int gapAllowance, int ppmTol, int threads){
+    vector<vector<string> > results(spectra.size());
+
+    if (threads < 1) threads = (int)thread::hardware_concurrency();
+    if (threads < 1) threads = 1;
+    if (threads > (int)spectra.size()) threads = (int)spectra.size();
+
+    // threads take the next spectrum until there are none left. Every
+    // spectrum has its own slot in results, so nothing else is shared
+    atomic<int> next(0);
+    vector<thread> workers;
+    for (int t = 0; t < threads; t++){
+        workers.push_back(thread([&](){
+            FuzzySearchScratch<typename Graph::Node> scratch;
+
+            for (int i = next++; i < (int)spectra.size(); i = next++){
+                fuzzySearchGraph(graph, spectra[i].data(), (int)spectra[i].size(), gapAllowance, ppmTol, scratch, results[i]);
+            }
+        }));
+    }
+    for (thread & worker: workers) worker.join();
+
+    return results;
+}
+
+/**
+ * State of a top k search. As in FuzzySearchScratch, peaks used by the nodes on
+ * the current path are set in a bitmask that logs them so they can be given back. Each peak
+ * has a weight (1, or its intensity) and a path scores the weight of the peaks
+ * it matched. The best nodes found so far are kept with their kmers so the
+ * score a branch has to beat to make the top k is always known.
+*/
+template <class Node>
+class TopKSearchState {
+public:
+    // a node in the running and the best score of the paths that reached it
+    struct Candidate {
+        double score;
+        vector<string> kmers;
+    };
+
+    int k;
+    // the peaks of the spectrum, sorted smallest to largest, and their weights
+    vector<FixedMass> peaks;
+    vector<double> weights;
+    // suffixWeights[i] is the weight of peaks[i] and every peak after it
+    vector<double> suffixWeights;
+    // the most weight one node can match with all of its windows
+    double nodeWeight;
+    // the peaks used by nodes on the current path
+    PeakMask consumed;
+    // the number of peaks not yet consumed
+    int remaining;
+
+    map<Node, Candidate> candidates;
+    // the candidates, worst score first
+    set<pair<double, Node> > ranked;
+    // the number of kmers of all the candidates
+    int kmerCount;
+
+    // counters for the current search, or null
+    SearchStats * stats;
+
+    /**
+     * @param sequence      const float *   the masses of the spectrum
+     * @param intensities   const float *   the intensity of each mass, or null to count matched masses
+     * @param length        int             the number of masses
+     * @param k             int             the number of kmers wanted
+     * @param ppmTol        int             the tolerance in parts per million of the search
+     * @param stats         SearchStats *   counters for the search, or null
+    */
+    TopKSearchState(const float * sequence, const float * intensities, int length, int k, int ppmTol, SearchStats * stats){
+        vector<FixedMass> masses;
+        fixedPeaks(sequence, length, masses);
+
+        vector<int> order(length);
+        for (int i = 0; i < length; i++) order[i] = i;
+        sort(order.begin(), order.end(), [&](int a, int b){ return masses[a] < masses[b]; });
+
+        for (int i: order){
+            this->peaks.push_back(masses[i]);
+            this->weights.push_back(intensities == nullptr ? 1.0 : (double)intensities[i]);
+        }
+
+        this->suffixWeights.assign(length + 1, 0);
+        for (int i = length - 1; i >= 0; i--) this->suffixWeights[i] = this->suffixWeights[i + 1] + this->weights[i];
+
+        // a window that matches anything is no wider than one around twice the largest
+        // peak, so the heaviest span of peaks that wide bounds what a window can match
+        double heaviest = 0;
+        if (length > 0){
+            // the tolerance of the largest peak either side of 0, rounded up so the
+            // doubled mass's window is never wider than this
+            int64_t tolerance = max(ppmToFixed(this->peaks.front(), ppmTol), ppmToFixed(this->peaks.back(), ppmTol));
+            int64_t width = 2 * (2 * tolerance + 1);
+            double spanWeight = 0;
+            for (int first = 0, last = 0; first < length; first++){
+                for (; last < length && this->peaks[last] <= this->peaks[first] + width; last++) spanWeight += this->weights[last];
+                heaviest = max(heaviest, spanWeight);
+                spanWeight -= this->weights[first];
+            }
+        }
+        this->nodeWeight = MassWindows::charges * heaviest;
+
+        this->consumed.reset(length);
+        this->remaining = length;
+        this->k = k;
+        this->kmerCount = 0;
+        this->stats = stats;
+    }
+
+    // the weight of the peaks set in bits, which are the peaks word * 64 on
+    double bitsWeight(int word, uint64_t bits) const {
+        double weight = 0;
+        for (; bits; bits &= bits - 1) weight += this->weights[(word << 6) + __builtin_ctzll(bits)];
+        return weight;
+    }
+
+    // consume every peak in [lowerBound, upperBound] that has not been consumed yet, returning their weight
+    double consumeWindow(FixedMass lowerBound, FixedMass upperBound){
+        int mark = this->consumed.mark();
+        WindowMatches matches = findWindow(this->peaks.data(), (int)this->peaks.size(), lowerBound, upperBound);
+        this->remaining -= this->consumed.consume(matches.start, matches.end);
+
+        double weight = 0;
+        for (int i = mark; i < (int)this->consumed.log.size(); i++) weight += this->bitsWeight(this->consumed.log[i].word, this->consumed.log[i].bits);
+        return weight;
+    }
+
+    // give back the peaks consumed since logStart
+    void release(int logStart){
+        this->remaining += this->consumed.release(logStart);
+    }
+
+    // the weight of the peaks at or above lowerBound that have not been consumed
+    double weightAbove(FixedMass lowerBound) const {
+        int start = windowStart(this->peaks, lowerBound);
+        double weight = this->suffixWeights[start];
+        for (const PeakMask::Change & change: this->consumed.log){
+            // only the bits of peaks start and on
+            uint64_t bits = change.bits;
+            if (change.word < (start >> 6)) continue;
+            if (change.word == (start >> 6)) bits &= ~(((uint64_t)1 << (start & 63)) - 1);
+
+            weight -= this->bitsWeight(change.word, bits);
+        }
+        return weight;
+    }
+
+    // true if a path scoring bound could make the top k. A tie with the kth kmer can,
+    // since ties are ordered by kmer and not by which was found first
+    bool canBeat(double bound) const {
+        return this->kmerCount < this->k || bound >= this->ranked.begin()->first;
+    }
+
+    // drop the worst scoring candidates while the rest still hold k kmers. Candidates
+    // with the same score are dropped together so ties do not depend on the node order
+    void trim(){
+        while (!this->ranked.empty()){
+            double worst = this->ranked.begin()->first;
+
+            int worstKmers = 0;
+            typename set<pair<double, Node> >::iterator it = this->ranked.begin();
+            for (; it != this->ranked.end() && it->first == worst; it++) worstKmers += (int)this->candidates[it->second].kmers.size();
+
+            if (this->kmerCount - worstKmers < this->k) return;
+
+            for (typename set<pair<double, Node> >::iterator drop = this->ranked.begin(); drop != it; drop++) this->candidates.erase(drop->second);
+            this->ranked.erase(this->ranked.begin(), it);
+            this->kmerCount -= worstKmers;
+        }
+    }
+};
+
+/**
+ * Offer the kmers of a node to the top k with the score of the path that reached it
+ *
+ * @param graph     Graph                   The graph being searched
+ * @param node      Graph::Node             The node that ends the path
+ * @param score     double                  the score of the path
+ * @param state     TopKSearchState &       the state of the search
+*/
+template <class Graph>
+void topKSearchGraphOffer(const Graph & graph, typename Graph::Node node, double score, TopKSearchState<typename Graph::Node> & state){
+    if (!state.canBeat(score)) return;
+
+    typedef typename TopKSearchState<typename Graph::Node>::Candidate Candidate;
+    typename map<typename Graph::Node, Candidate>::iterator found = state.candidates.find(node);
+
+    // another path already reached this node, keep the better score
+    if (found != state.candidates.end()){
+        if (found->second.score >= score) return;
+
+        state.ranked.erase(make_pair(found->second.score, node));
+        found->second.score = score;
+        state.ranked.insert(make_pair(score, node));
+    }
+    else {
+        Candidate & candidate = state.candidates[node];
+        candidate.score = score;
+        graph.appendKmers(node, candidate.kmers);
+
+        state.kmerCount += (int)candidate.kmers.size();
+        state.ranked.insert(make_pair(score, node));
+    }
+
+    state.trim();
+}
+
+/**
+ * Visit a node in the top k search and everything under it that could still make the top k
+ *
+ * @param graph         Graph                   The graph being searched
+ * @param node          Graph::Node             The node to visit
+ * @param depth         int                     the number of nodes on the path to this node, including it
+ * @param currentGap    int                     the gaps used by the path to this node
+ * @param score         double                  the score of the path to this node
+ * @param gapAllowance  int                     The number of gaps to allow in the search
+ * @param ppmTol        int                     the tolerance in parts per million to accept when searching
+ * @param state         TopKSearchState &       the state of the search
+ *
+ * @return bool     True if this node or any node under it matched a mass
+*/
+template <class Graph>
+bool topKSearchGraphVisit(const Graph & graph, typename Graph::Node node, int depth, int currentGap, double score,
+    int gapAllowance, int ppmTol, TopKSearchState<typename Graph::Node> & state){
+
+    // BASE CASE: we're past our limit or every peak has been used
+    if ((gapAllowance - currentGap) < 0 || state.remaining == 0) return false;
+
+    SEARCH_STATS_ADD(state.stats, nodesVisited, 1);
+    SEARCH_STATS_ADD(state.stats, toleranceChecks, MassWindows::charges);
+    SEARCH_STATS_MAX(state.stats, maxDepth, depth);
+
+    MassWindows windows = graph.windows(node, ppmTol);
+
+    int logStart = state.consumed.mark();
+    for (int z = 0; z < MassWindows::charges; z++) score += state.consumeWindow(windows.lower[z], windows.upper[z]);
+
+    bool massFound = state.consumed.mark() > logStart;
+
+    SEARCH_STATS_ADD(state.stats, gapBranches, massFound ? 0 : 1);
+
+    // the masses only grow going down, so nothing under this node can match a peak
+    // below its highest charge window, and there are at most maxDepth - depth nodes left to match
+    double bound = score + min(state.weightAbove(windows.lower[MassWindows::charges - 1]), (graph.maxDepth() - depth) * state.nodeWeight);
+
+    bool deeperMatch = false;
+    for (int c = 0; c < graph.childCount(node) && state.remaining > 0; c++){
+        if (!state.canBeat(bound)) break;
+
+        bool childMatch = topKSearchGraphVisit(graph, graph.child(node, c), depth + 1, currentGap + (massFound ? 0 : 1), score, gapAllowance, ppmTol, state);
+        deeperMatch = deeperMatch || childMatch;
+    }
+
+    // like fuzzySearch, only the deepest node that matched on a branch is a result
+    if (massFound && !deeperMatch) topKSearchGraphOffer(graph, node, score, state);
+
+    state.release(logStart);
+    return massFound || deeperMatch;
+}
+
+/**
+ * Search for the input sequence like fuzzySearch, but score each path by the
+ * peaks it matches (or the sum of their intensities) and return only the k
+ * best kmers. Branches whose best possible score is below the kth best
+ * kmer found so far are not searched, which assumes masses only grow along a
+ * path and that the masses of higher charges are lower, as for b ions. Branches
+ * that can only tie it are, so ties are broken by kmer and not by the walk order.
+ *
+ * @param graph         Graph           the graph to search
+ * @param sequence      const float *   the sequence to search
+ * @param intensities   const float *   the intensity of each mass in sequence, or null to count matched masses
+ * @param length        int             the number of masses in sequence
+ * @param k             int             the number of kmers to return
+ * @param gapAllowance  int             The number of gaps to allow in the search
+ * @param ppmTol        int             the tolerance in parts per million to accept when searching
+ * @param stats         SearchStats *   counters for the search, or null
+ *
+ * @return vector<ScoredKmer>   up to k kmers, best score first
+ *
+ * @throws invalid_argument     if an intensity is negative
+*/
+template <class Graph>
+vector<ScoredKmer> topKSearchGraph(const Graph & graph, const float * sequence, const float * intensities, int length,
+    int k, int gapAllowance, int ppmTol, SearchStats * stats = nullptr){
+
+    typedef typename Graph::Node Node;
+
+    if (intensities != nullptr){
+        for (int i = 0; i < length; i++){
+            if (intensities[i] < 0) throw invalid_argument("intensities can not be negative");
+        }
+    }
+    if (k < 1 || length == 0) return vector<ScoredKmer> {};
+
+    TopKSearchState<Node> state(sequence, intensities, length, k, ppmTol, stats);
+
+    Node root = graph.root();
+    for (int r = 0; r < graph.childCount(root); r++){
+        if (!state.canBeat(state.weightAbove(0))) break;
+        topKSearchGraphVisit(graph, graph.child(root, r), 1, 0, 0, gapAllowance, ppmTol, state);
+    }
+
+    vector<ScoredKmer> results;
+    for (const pair<const Node, typename TopKSearchState<Node>::Candidate> & candidate: state.candidates){
+        for (const string & kmer: candidate.second.kmers) results.push_back(ScoredKmer(kmer, (float)candidate.second.score));
+    }
+    sort(results.begin(), results.end());
+    if ((int)results.size() > k) results.resize(k);
+
+    SEARCH_STATS_ADD(stats, resultsEmitted, (long)results.size());
+    return results;
+}
+
+/**
+ * A search with no gaps allowed
+ *
+ * @param graph          Graph           the graph to search
+ * @param sequence       const float *   the sequence to search
+ * @param length         int             the number of masses in sequence
+ * @param ppmTol         int             the tolerance in parts per million to accept when searching
+ * @param stats          SearchStats *   counters for the search, or null
+ *
+ * @return vector<string>                All kmers that we found in the search
+*/
+template <class Graph>
+vector<string> searchGraph(const Graph & graph, const float * sequence, int length, int ppmTol, SearchStats * stats = nullptr){
+    typedef typename Graph::Node Node;
+
+    Node currentNode = graph.root();
+
+    if (length == 0) return vector<string> {};
+
+    // sort the masses once so every tolerance check is a binary search
+    vector<FixedMass> remaining;
+    fixedPeaks(sequence, length, remaining);
+    sort(remaining.begin(), remaining.end());
+
+    // the search only goes down, one node per step
+    int depth = 0;
+    while (true){
+
+        // of the children that have a mass in the sequence, take the one with the lowest 
+        // singly mass. Children are sorted by singly mass, so that is the first one found
+        bool found = false;
+        Node smallest = currentNode;
+
+        // go through each child and see if the masses fit the tolerance
+        for (int c = 0; c < graph.childCount(currentNode) && !found; c++){
+            Node child = graph.child(currentNode, c);
+
+            SEARCH_STATS_ADD(stats, nodesVisited, 1);
+            SEARCH_STATS_ADD(stats, toleranceChecks, MassWindows::charges);
+
+            // check to see if any of the values in the sequence are within
+            // the range of the masses within this node at any charge
+            MassWindows windows = graph.windows(child, ppmTol);
+
+            for (int z = 0; z < MassWindows::charges && !found; z++){
+                if (anyInWindow(remaining, windows.lower[z], windows.upper[z])){
+                    found = true;
+                    smallest = child;
+                }
+            }
+        }
+
+        if (!found) break;
+
+        // the smallest child is our new currentNode and we need to update the sequence
+        // to not include masses that the child has: everything up to the window of
+        // the highest charge and everything in the windows of the lower charges
+        MassWindows windows = graph.windows(smallest, ppmTol);
+        const int last = MassWindows::charges - 1;
+
+        for (int z = 0; z < last; z++){
+            vector<FixedMass>::iterator first = lower_bound(remaining.begin(), remaining.end(), windows.lower[z]);
+            remaining.erase(first, upper_bound(first, remaining.end(), windows.upper[z]));
+        }
+        remaining.erase(remaining.begin(), upper_bound(remaining.begin(), remaining.end(), windows.upper[last]));
+
+        currentNode = smallest;
+        depth ++;
+        SEARCH_STATS_MAX(stats, maxDepth, depth);
+    }
+
+    vector<string> results;
+    graph.appendKmers(currentNode, results);
+    SEARCH_STATS_ADD(stats, resultsEmitted, (int)results.size());
+    return results;
+}
+#endif
@@ -0,0 +1,180 @@
+#include <cstring>
+#include <stdexcept>
+
+#include "KmerTable.hpp"
+
+// marks an empty slot in the hash table
+#define EMPTY_SLOT      0xFFFFFFFF
+
+// FNV-1a, which can be extended one character at a time for prefixes
+#define FNV_OFFSET      14695981039346656037ULL
+#define FNV_PRIME       1099511628211ULL
+
+static inline uint64_t hashStep(uint64_t hash, char c){
+    return (hash ^ (unsigned char)c) * FNV_PRIME;
+}
+
+static inline uint64_t hashChars(const char * kmer, uint32_t length){
+    uint64_t hash = FNV_OFFSET;
+    for (uint32_t i = 0; i < length; i++) hash = hashStep(hash, kmer[i]);
+    return hash;
+}
+
+KmerTable::KmerTable(){
+    this->slots = vector<uint32_t>(1024, EMPTY_SLOT);
+    this->longest = 0;
+}
+
+/**
+ * Get the id of a kmer, adding it to the table if it is new
+ *
+ * @param kmer      string      the kmer to intern
+ *
+ * @return uint32_t     the id of the kmer
+ *
+ * @throws length_error     if the characters of a new kmer would not fit in 32 bit offsets
+*/
+uint32_t KmerTable::intern(const string & kmer){
+    uint32_t length = (uint32_t)kmer.size();
+    uint32_t slot = this->findSlot(kmer.data(), length, hashChars(kmer.data(), length));
+
+    if (this->slots[slot] != EMPTY_SLOT) return this->slots[slot];
+
+    // offsets are 32 bits, so past 4 GiB of characters they would wrap around to the wrong kmers
+    if ((uint64_t)this->chars.size() + kmer.size() > UINT32_MAX) throw length_error("the kmer table can not hold more than 4 GiB of characters");
+
+    uint32_t offset = (uint32_t)this->chars.size();
+    this->chars += kmer;
+
+    return this->add(offset, length, slot);
+}
+
+/**
+ * Intern every prefix of a kmer (including the kmer itself)
+ *
+ * @param kmer      string              the kmer whose prefixes we want
+ * @param ids       vector<uint32_t> &  filled so ids[i] is the id of the first i + 1 characters of kmer
+ *
+ * @throws length_error     if the characters of a new kmer would not fit in 32 bit offsets
+*/
+void KmerTable::internPrefixes(const string & kmer, vector<uint32_t> & ids){
+    ids.clear();
+    if (kmer.empty()) return;
+
+    // the full kmer owns the characters all of the prefixes point to
+    uint32_t fullId = this->intern(kmer);
+    uint32_t offset = this->offsets[fullId];
+
+    uint64_t hash = FNV_OFFSET;
+    for (uint32_t i = 0; i < (uint32_t)kmer.size() - 1; i++){
+        hash = hashStep(hash, kmer[i]);
+        uint32_t slot = this->findSlot(kmer.data(), i + 1, hash);
+
+        if (this->slots[slot] != EMPTY_SLOT) ids.push_back(this->slots[slot]);
+        else ids.push_back(this->add(offset, i + 1, slot));
+    }
+    ids.push_back(fullId);
+}
+
+/**
+ * Look up the ids of every prefix of a kmer that was already interned with
+ * internPrefixes. The table is not changed, so many threads can call this
+ *
+ * @param kmer      string              the kmer whose prefixes we want
+ * @param ids       vector<uint32_t> &  filled so ids[i] is the id of the first i + 1 characters of kmer
+*/
+void KmerTable::findPrefixes(const string & kmer, vector<uint32_t> & ids) const {
+    ids.clear();
+
+    uint64_t hash = FNV_OFFSET;
+    for (uint32_t i = 0; i < (uint32_t)kmer.size(); i++){
+        hash = hashStep(hash, kmer[i]);
+        ids.push_back(this->slots[this->findSlot(kmer.data(), i + 1, hash)]);
+    }
+}
+
+/**
+ * Look up the id of a kmer without adding it
+ *
+ * @param kmer      string      the kmer to look for
+ *
+ * @return uint32_t     the id of the kmer, or an id past the end of the table if it is not in it
+*/
+uint32_t KmerTable::find(const string & kmer) const {
+    uint32_t length = (uint32_t)kmer.size();
+    return this->slots[this->findSlot(kmer.data(), length, hashChars(kmer.data(), length))];
+}
+
+/**
+ * Materialize the string of a kmer id
+ *
+ * @param id    uint32_t    the id of the kmer
+ *
+ * @return string   the kmer
+*/
+string KmerTable::get(uint32_t id) const {
+    return this->chars.substr(this->offsets[id], this->lengths[id]);
+}
+
+// bytes used by the table
+size_t KmerTable::memoryUsage() const {
+    return this->chars.capacity()
+        + (this->offsets.capacity() + this->lengths.capacity() + this->slots.capacity()) * sizeof(uint32_t);
+}
+
+/**
+ * Find the id of the characters at kmer with the given length and hash
+ *
+ * @param kmer      const char *    the characters to look for
+ * @param length    uint32_t        the number of characters
+ * @param hash      uint64_t        the hash of the characters
+ *
+ * @return uint32_t     the slot holding the id, or the empty slot where it should go
+*/
+uint32_t KmerTable::findSlot(const char * kmer, uint32_t length, uint64_t hash) const {
+    uint32_t mask = (uint32_t)this->slots.size() - 1;
+    uint32_t slot = (uint32_t)hash & mask;
+
+    // linear probe until we find the kmer or an empty slot
+    while (this->slots[slot] != EMPTY_SLOT){
+        uint32_t id = this->slots[slot];
+        if (this->lengths[id] == length && memcmp(this->chars.data() + this->offsets[id], kmer, length) == 0) break;
+
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+/**
+ * Add a kmer whose characters are already in chars
+ *
+ * @param offset    uint32_t    where the characters start
+ * @param length    uint32_t    the number of characters
+ * @param slot      uint32_t    the empty slot for the new id
+ *
+ * @return uint32_t     the new id
+*/
+uint32_t KmerTable::add(uint32_t offset, uint32_t length, uint32_t slot){
+    uint32_t id = (uint32_t)this->offsets.size();
+    this->offsets.push_back(offset);
+    this->lengths.push_back(length);
+    this->slots[slot] = id;
+    if (length > this->longest) this->longest = length;
+
+    // keep the table at most half full so probes stay short
+    if (this->offsets.size() * 2 > this->slots.size()) this->grow();
+
+    return id;
+}
+
+// double the number of slots and rehash every id
+void KmerTable::grow(){
+    this->slots = vector<uint32_t>(this->slots.size() * 2, EMPTY_SLOT);
+    uint32_t mask = (uint32_t)this->slots.size() - 1;
+
+    for (uint32_t id = 0; id < (uint32_t)this->offsets.size(); id++){
+        uint32_t slot = (uint32_t)hashChars(this->chars.data() + this->offsets[id], this->lengths[id]) & mask;
+        while (this->slots[slot] != EMPTY_SLOT) slot = (slot + 1) & mask;
+        this->slots[slot] = id;
+    }
+}
@@ -0,0 +1,120 @@
+#ifndef KMERTABLE_H
+#define KMERTABLE_H
+
+#include <vector>
+#include <string>
+#include <cstdint>
+
+using namespace std;
+
+/**
+ * Interns kmers as 32 bit ids so nodes do not each hold their own strings.
+ * The characters of every kmer are stored once in one buffer and a prefix
+ * of a kmer points into the characters of that kmer, so adding all of the
+ * prefixes of a peptide does not copy any characters.
+*/
+class KmerTable {
+public:
+    KmerTable();
+
+    ~KmerTable(){}
+
+    /**
+     * Get the id of a kmer, adding it to the table if it is new
+     *
+     * @param kmer      string      the kmer to intern
+     *
+     * @return uint32_t     the id of the kmer
+     *
+     * @throws length_error     if the characters of a new kmer would not fit in 32 bit offsets
+    */
+    uint32_t intern(const string & kmer);
+
+    /**
+     * Intern every prefix of a kmer (including the kmer itself)
+     *
+     * @param kmer      string              the kmer whose prefixes we want
+     * @param ids       vector<uint32_t> &  filled so ids[i] is the id of the first i + 1 characters of kmer
+     *
+     * @throws length_error     if the characters of a new kmer would not fit in 32 bit offsets
+    */
+    void internPrefixes(const string & kmer, vector<uint32_t> & ids);
+
+    /**
+     * Look up the ids of every prefix of a kmer that was already interned with
+     * internPrefixes. The table is not changed, so many threads can call this
+     *
+     * @param kmer      string              the kmer whose prefixes we want
+     * @param ids       vector<uint32_t> &  filled so ids[i] is the id of the first i + 1 characters of kmer
+    */
+    void findPrefixes(const string & kmer, vector<uint32_t> & ids) const;
+
+    /**
+     * Look up the id of a kmer without adding it
+     *
+     * @param kmer      string      the kmer to look for
+     *
+     * @return uint32_t     the id of the kmer, or an id past the end of the table if it is not in it
+    */
+    uint32_t find(const string & kmer) const;
+
+    /**
+     * Materialize the string of a kmer id
+     *
+     * @param id    uint32_t    the id of the kmer
+     *
+     * @return string   the kmer
+    */
+    string get(uint32_t id) const;
+
+    // the number of kmers in the table
+    int size() const { return (int)this->offsets.size(); }
+
+    // the length of the longest kmer in the table
+    uint32_t maxLength() const { return this->longest; }
+
+    // where the characters of a kmer start in characters() and how many there are
+    uint32_t offset(uint32_t id) const { return this->offsets[id]; }
+    uint32_t length(uint32_t id) const { return this->lengths[id]; }
+    const string & characters() const { return this->chars; }
+
+    // bytes used by the table
+    size_t memoryUsage() const;
+
+private:
+    // the characters of every kmer that was not already a prefix of a stored kmer when it was interned
+    string chars;
+    // kmer id i is chars[offsets[i], offsets[i] + lengths[i])
+    vector<uint32_t> offsets;
+    vector<uint32_t> lengths;
+    uint32_t longest;
+
+    // open addressing hash table of ids, sized to a power of 2
+    vector<uint32_t> slots;
+
+    /**
+     * Find the id of the characters at kmer with the given length and hash
+     *
+     * @param kmer      const char *    the characters to look for
+     * @param length    uint32_t        the number of characters
+     * @param hash      uint64_t        the hash of the characters
+     *
+     * @return uint32_t     the slot holding the id, or the empty slot where it should go
+    */
+    uint32_t findSlot(const char * kmer, uint32_t length, uint64_t hash) const;
+
+    /**
+     * Add a kmer whose characters are already in chars
+     *
+     * @param offset    uint32_t    where the characters start
+     * @param length    uint32_t    the number of characters
+     * @param slot      uint32_t    the empty slot for the new id
+     *
+     * @return uint32_t     the new id
+    */
+    uint32_t add(uint32_t offset, uint32_t length, uint32_t slot);
+
+    // double the number of slots and rehash every id
+    void grow();
+};
+#endif
@@ -1,29 +1,57 @@
 #include "MassDawg.hpp"
 #include "utils.hpp"
+#include "GraphSearch.hpp"
+
+#include <stdexcept>
+#include <map>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <unordered_map>
+#include <algorithm>
 
 /*******************Public methods*******************/
 
-LongestCommonPrefix::LongestCommonPrefix(vector<float> sS, vector<float> dS, vector<MassDawgNode *> nodes){
-        this->singlySequence = sS;
-        this->doublySequence = dS;
+LongestCommonPrefix::LongestCommonPrefix(vector<NodeMasses> sequence, vector<MassDawgNode *> nodes){
+        this->sequence = sequence;
         this->nodes = nodes;
     };
 
+/**
+ * Convert singly and doubly charged masses in daltons to the fixed point
+ * masses of a node at every charge
+ * 
+ * @param singlySequence    const float *           the singly charged masses
+ * @param doublySequence    const float *           the doubly charged masses
+ * @param length            int                     the number of masses in each sequence
+ * @param out               vector<NodeMasses> &    filled with the masses of each node
+ * 
+ * @throws invalid_argument     if a mass is too large or small for a FixedMass, or not a number
+*/
+static void toNodeMasses(const float * singlySequence, const float * doublySequence, int length, vector<NodeMasses> & out){
+    out.resize(length);
+    for (int i = 0; i < length; i++){
+        if (!fixedMassInRange(singlySequence[i]) || !fixedMassInRange(doublySequence[i])){
+            throw invalid_argument("masses must be numbers within the range of a FixedMass");
+        }
+        out[i] = nodeMasses(toFixedMass(singlySequence[i]), toFixedMass(doublySequence[i]));
+    }
+}
+
 // empty constructor takes no values
 MassDawg::MassDawg(){
-    this->root = new MassDawgNode();
+    this->root = this->arena.allocate();
 }
 
-MassDawg::~MassDawg(){
-    delete this->root;
-}
+// all nodes are freed when the arena is destroyed
+MassDawg::~MassDawg(){}
 
 /**
  * Show the graph as a tree in the console
 */
 void MassDawg::show(){
     cout << "\nroot\n";
-    for (int i  = 0; i < (int)this->root->children.size(); i ++) this->root->children[i]->show(2);
+    for (int i  = 0; i < (int)this->root->children.size(); i ++) this->root->children[i]->show(2, this->kmers);
 }
 
 /**
@@ -34,24 +62,235 @@ void MassDawg::show(){
  * @param kmer              string          the sequence of amino acids associated with this mass
 */
 void MassDawg::insert(vector<float> singlySequence, vector<float> doublySequence, string kmer){
+    if (singlySequence.size() != doublySequence.size()){
+        throw invalid_argument("singlySequence, doublySequence and kmer must be the same non zero length");
+    }
+
+    this->insert(singlySequence.data(), doublySequence.data(), (int)singlySequence.size(), kmer);
+}
+
+/**
+ * Add a new singly and doubly charged sequence associated with the kmer to the graph
+ * from arrays of masses, such as the buffers of numpy arrays
+ * 
+ * @param singlySequence    const float *   the singly charged sequence of masses
+ * @param doublySequence    const float *   the doubly charged sequence of masses
+ * @param length            int             the number of masses in each sequence
+ * @param kmer              string          the sequence of amino acids associated with this mass
+*/
+void MassDawg::insert(const float * singlySequence, const float * doublySequence, int length, const string & kmer){
+    if (length != (int)kmer.size() || kmer.empty()){
+        throw invalid_argument("singlySequence, doublySequence and kmer must be the same non zero length");
+    }
+
+    // masses are rounded to fixed point once, everything after compares integers
+    vector<NodeMasses> sequence;
+    toNodeMasses(singlySequence, doublySequence, length, sequence);
+
+    // intern the kmer and all of its prefixes once so nodes only hold ids
+    this->kmers.internPrefixes(kmer, this->prefixIds);
+    this->countInsertion();
+    this->insertInterned(sequence);
+}
+
+/**
+ * Add a new sequence associated with the kmer to the graph from the masses of
+ * each node already in fixed point units, which are inserted as they are
+ * 
+ * @param sequence      const NodeMasses *  the masses at every charge of each node
+ * @param length        int                 the number of nodes in the sequence
+ * @param kmer          string              the sequence of amino acids associated with this mass
+*/
+void MassDawg::insert(const NodeMasses * sequence, int length, const string & kmer){
+    if (length != (int)kmer.size() || kmer.empty()){
+        throw invalid_argument("sequence and kmer must be the same non zero length");
+    }
+
+    this->kmers.internPrefixes(kmer, this->prefixIds);
+    this->countInsertion();
+    this->insertInterned(vector<NodeMasses>(sequence, sequence + length));
+}
+
+/**
+ * Add many sequences at once, building them over a pool of threads. The kmers are
+ * split into shards by the masses of their first edge (the child of the root they
+ * hang off of), each shard is built and minimized as its own graph on a thread and
+ * the shards are then merged under the root, combining nodes with the same masses
+ * across shards. Any earlier insertions are finished first and the graph is
+ * finished afterwards
+ * 
+ * @param singlySequences   vector<vector<float>>   the singly charged sequence of masses of each kmer
+ * @param doublySequences   vector<vector<float>>   the doubly charged sequence of masses of each kmer
+ * @param kmers             vector<string>          the sequences of amino acids associated with the masses
+ * @param threads           int                     the number of threads to use. If < 1, one per core is used
+*/
+void MassDawg::parallelInsert(const vector<vector<float> > & singlySequences, const vector<vector<float> > & doublySequences, const vector<string> & kmers, int threads){
+    if (singlySequences.size() != doublySequences.size() || singlySequences.size() != kmers.size()){
+        throw invalid_argument("singlySequences, doublySequences and kmers must have the same number of entries");
+    }
+
+    // check and convert everything up front so nothing throws on a worker thread
+    vector<vector<NodeMasses> > sequences(kmers.size());
+    for (int i = 0; i < (int)kmers.size(); i++){
+        if (singlySequences[i].size() != doublySequences[i].size() || singlySequences[i].size() != kmers[i].size() || kmers[i].empty()){
+            throw invalid_argument("singlySequence, doublySequence and kmer must be the same non zero length");
+        }
+        toNodeMasses(singlySequences[i].data(), doublySequences[i].data(), (int)singlySequences[i].size(), sequences[i]);
+    }
+
+    this->finish();
+
+    // ids are given out here, so every shard shares the ids of this graph and
+    // only has to look them up
+    for (const string & kmer: kmers){
+        this->kmers.internPrefixes(kmer, this->prefixIds);
+        this->countInsertion();
+    }
+
+    // group the kmers by the masses of their first edge. Ordered so the
+    // shards are always merged in the same order
+    map<NodeMasses, vector<int> > shardMembers;
+    for (int i = 0; i < (int)kmers.size(); i++) shardMembers[sequences[i][0]].push_back(i);
+
+    vector<vector<int> *> members;
+    for (auto & entry: shardMembers) members.push_back(&entry.second);
+
+    vector<unique_ptr<MassDawg> > shards(members.size());
+    if (threads < 1) threads = (int)thread::hardware_concurrency();
+    if (threads < 1) threads = 1;
+    if (threads > (int)members.size()) threads = (int)members.size();
+
+    // threads take the next shard until there are none left
+    atomic<int> next(0);
+    vector<thread> workers;
+    for (int t = 0; t < threads; t++){
+        workers.push_back(thread([&](){
+            for (int s = next++; s < (int)members.size(); s = next++){
+                vector<int> & order = *members[s];
+
+                // sorted input takes the fast path of insert
+                sort(order.begin(), order.end(), [&](int a, int b){ return sequences[a] < sequences[b]; });
+
+                MassDawg * shard = new MassDawg();
+                for (int i: order){
+                    this->kmers.findPrefixes(kmers[i], shard->prefixIds);
+                    shard->insertInterned(sequences[i]);
+                }
+                shard->finish();
+
+                shards[s].reset(shard);
+            }
+        }));
+    }
+    for (thread & worker: workers) worker.join();
+
+    // the root children of the shards all differ, deeper nodes are combined by merge
+    for (unique_ptr<MassDawg> & shard: shards) this->merge(*shard);
+}
+
+/**
+ * Remove one insertion of a singly and doubly charged sequence and its kmer from
+ * the graph, undoing the insert made with the same masses and kmer. The kmer stays
+ * in the graph until it has been removed as many times as it was inserted. Nodes
+ * no other insertion reaches are pruned, so the graph stays minimized, and only the
+ * nodes of the sequence are visited. Any unchecked nodes are merged first
+ * 
+ * @param singlySequence    vector<float>   the singly charged sequence of masses it was inserted with
+ * @param doublySequence    vector<float>   the doubly charged sequence of masses it was inserted with
+ * @param kmer              string          the sequence of amino acids it was inserted with
+ * 
+ * @return bool     True if the sequence was in the graph and was removed, False otherwise
+*/
+bool MassDawg::remove(vector<float> singlySequence, vector<float> doublySequence, string kmer){
+    if (singlySequence.size() != doublySequence.size()){
+        throw invalid_argument("singlySequence, doublySequence and kmer must be the same non zero length");
+    }
+
+    return this->remove(singlySequence.data(), doublySequence.data(), (int)singlySequence.size(), kmer);
+}
+
+/**
+ * Remove one insertion of a singly and doubly charged sequence and its kmer from
+ * the graph from arrays of masses, such as the buffers of numpy arrays
+ * 
+ * @param singlySequence    const float *   the singly charged sequence of masses it was inserted with
+ * @param doublySequence    const float *   the doubly charged sequence of masses it was inserted with
+ * @param length            int             the number of masses in each sequence
+ * @param kmer              string          the sequence of amino acids it was inserted with
+ * 
+ * @return bool     True if the sequence was in the graph and was removed, False otherwise
+*/
+bool MassDawg::remove(const float * singlySequence, const float * doublySequence, int length, const string & kmer){
+    if (length != (int)kmer.size() || kmer.empty()){
+        throw invalid_argument("singlySequence, doublySequence and kmer must be the same non zero length");
+    }
+
+    vector<NodeMasses> sequence;
+    toNodeMasses(singlySequence, doublySequence, length, sequence);
+
+    // a kmer that was never inserted is not interned, so it is not added here
+    this->kmers.findPrefixes(kmer, this->prefixIds);
+    return this->removeInterned(sequence);
+}
+
+/**
+ * Remove one insertion of a sequence and its kmer from the graph with the masses
+ * of each node already in fixed point units
+ * 
+ * @param sequence      const NodeMasses *  the masses at every charge of each node it was inserted with
+ * @param length        int                 the number of nodes in the sequence
+ * @param kmer          string              the sequence of amino acids it was inserted with
+ * 
+ * @return bool     True if the sequence was in the graph and was removed, False otherwise
+*/
+bool MassDawg::remove(const NodeMasses * sequence, int length, const string & kmer){
+    if (length != (int)kmer.size() || kmer.empty()){
+        throw invalid_argument("sequence and kmer must be the same non zero length");
+    }
+
+    this->kmers.findPrefixes(kmer, this->prefixIds);
+    return this->removeInterned(vector<NodeMasses>(sequence, sequence + length));
+}
+
+/**
+ * Count the insertions of a kmer that have not been removed
+ * 
+ * @param kmer      string      the sequence of amino acids
+ * 
+ * @return int      the number of times the kmer is in the graph, 0 if it is not
+*/
+int MassDawg::insertionCount(const string & kmer) const {
+    // prefixes of kmers are in the table too, but are only counted when inserted themselves
+    uint32_t id = this->kmers.find(kmer);
+    return id < this->insertions.size() ? (int)this->insertions[id] : 0;
+}
+
+/**
+ * Add a sequence whose kmer prefix ids are already in prefixIds
+ * 
+ * @param sequence      vector<NodeMasses>  the masses at every charge of each node
+*/
+void MassDawg::insertInterned(const vector<NodeMasses> & sequence){
     int commonPrefix = 0;
     LongestCommonPrefix lcp;
 
     // if the new seqeunce is greater than the old sequence, use the this->previousSequence
     // instance with its nodes for speed up in sorted input
-    if (this->previousIsLessThan(singlySequence, doublySequence)) {
+    if (this->previousIsLessThan(sequence)) {
 
         // find the common prefix between the new sequence and the last sequence (mass based)	
-        int iterLength = MIN((int)singlySequence.size(), (int)this->previousSequence.singlySequence.size());	
+        int iterLength = MIN((int)sequence.size(), (int)this->previousSequence.sequence.size());	
 
         // go through and see how much these sequences have in common	
         for (int i = 0; i < iterLength; i++){	
-            // if either of the singly or doubly sequences are not the same, break	
-            if ((singlySequence[i] != this->previousSequence.singlySequence[i]) 	
-            || (doublySequence[i] != this->previousSequence.doublySequence[i])) break;	
+            // if the masses at any charge are not the same, break	
+            if (sequence[i] != this->previousSequence.sequence[i]) break;	
 
             // update the kmer at the node at this position in the previous sequence
-            (*this->previousSequence.nodes[i]).addKmer(kmer.substr(0, i + 1));
+            // and count this insertion on the edge into it
+            MassDawgNode * parent = i == 0 ? this->root : this->previousSequence.nodes[i - 1];
+            parent->linkChild(this->previousSequence.nodes[i]);
+            (*this->previousSequence.nodes[i]).addKmer(this->prefixIds[i]);
 
             commonPrefix ++;	
         }
@@ -59,53 +298,66 @@ void MassDawg::insert(vector<float> singlySequence, vector<float> doublySequence
         // at the break, make lcp the previous sequence
         for (int i = 0; i < commonPrefix; i ++){
             lcp.nodes.push_back(this->previousSequence.nodes[i]);
-            lcp.singlySequence.push_back(singlySequence[i]);
-            lcp.doublySequence.push_back(doublySequence[i]);
+            lcp.sequence.push_back(sequence[i]);
         }
+
+        // minimize the previous sequence past the common prefix
+        this->minimize(commonPrefix);
     }	
 
     // otherise, in the case that the new sequence is smaller than previous (unsorted input)
     // find the longest common prefix
     else {
-        // get the longest common prefix of this new sequence
-        lcp = this->longestCommonPrefix(singlySequence, doublySequence);
+        // the prefix can run through any part of the graph, so finish the previous 
+        // sequence first so none of the nodes we find are merged away afterwards
+        this->minimize(0);
 
-        // add this kmer to all of the nodes in the lcp
-        for (MassDawgNode * node: lcp.nodes) node->addKmer(kmer);
-        commonPrefix = (int)lcp.singlySequence.size();
+        // get the longest common prefix of this new sequence
+        lcp = this->longestCommonPrefix(sequence);
+        commonPrefix = (int)lcp.nodes.size();
+
+        // add the prefixes of this kmer to all of the nodes in the lcp and
+        // count this insertion on the edges between them
+        for (int i = 0; i < commonPrefix; i++){
+            (i == 0 ? this->root : lcp.nodes[i - 1])->linkChild(lcp.nodes[i]);
+            lcp.nodes[i]->addKmer(this->prefixIds[i]);
+        }
     }
-    
 
-    // minimize the previous sequence
-    this->minimize(commonPrefix);
+    // new nodes hang off the end of the common prefix
+    MassDawgNode * currentNode = commonPrefix == 0 ? this->root : lcp.nodes.back();
 
-    // starting point in the graph for insertion
-    MassDawgNode * currentNode;
-    // if we don't have any unchecked nodes remaining, set our current 
-    // node to root, otherwise point to the last unchecked node
-    if (this->uncheckedNodes.size() == 0) currentNode = this->root;
-    else currentNode = this->uncheckedNodes.back().child;
+    // nodes are merged with every other node of the same masses, so the end of the
+    // prefix may already have children from other sequences (always the case after
+    // finish, when there is no previous sequence). Follow any with the masses we
+    // need, a second child with the same masses would become a second edge to one node
+    while (commonPrefix < (int)sequence.size()){
+        MassDawgNode * child = currentNode->findChild(sequence[commonPrefix]);
+        if (child == nullptr) break;
 
-    // create a new previous sequence object to keep track of what 
-    // we are doing now. We don't need all of the nodes, just the 
-    // nodes up until commonPrefix
-    PreviousSequence nextPreviousSequence;
-    nextPreviousSequence.singlySequence = singlySequence; 
-    nextPreviousSequence.doublySequence = doublySequence;
+        currentNode->linkChild(child);
+        child->addKmer(this->prefixIds[commonPrefix]);
+        lcp.nodes.push_back(child);
+        lcp.sequence.push_back(sequence[commonPrefix]);
 
-    // copy over all of the overlapped nodes
-    for (MassDawgNode * node: this->previousSequence.nodes){
-        nextPreviousSequence.nodes.push_back(node);
+        currentNode = child;
+        commonPrefix ++;
     }
 
+    // create a new previous sequence object to keep track of what 
+    // we are doing now. It starts with the nodes of the common prefix
+    PreviousSequence nextPreviousSequence;
+    nextPreviousSequence.sequence = sequence; 
+    nextPreviousSequence.nodes = lcp.nodes;
+
     // go through the remainder of the sequence and create new nodes
-    for (int i = commonPrefix; i < (int)singlySequence.size(); i ++){
+    for (int i = commonPrefix; i < (int)sequence.size(); i ++){
 
         // add a new child to my current node
         MassDawgNode * newChild = currentNode->addChild(
-            singlySequence[i], 
-            doublySequence[i], 
-            kmer.substr(0, i + 1)
+            sequence[i], 
+            this->prefixIds[i],
+            &this->arena
         );
 
         // add the pointer to the next node to previous nodes
@@ -115,6 +367,7 @@ void MassDawg::insert(vector<float> singlySequence, vector<float> doublySequence
         UncheckedNode un;
         un.child = newChild;
         un.parent = currentNode;
+        un.depth = i;
         this->uncheckedNodes.push_back(un);
 
         currentNode = newChild;
@@ -124,12 +377,122 @@ void MassDawg::insert(vector<float> singlySequence, vector<float> doublySequence
     this->previousSequence = nextPreviousSequence;
 }
 
+/**
+ * Remove one insertion of a sequence whose kmer prefix ids are in prefixIds.
+ * Prefixes that were never interned have ids past the end of insertions
+ * 
+ * @param sequence      vector<NodeMasses>  the masses at every charge of each node
+ * 
+ * @return bool     True if the sequence was in the graph and was removed, False otherwise
+*/
+bool MassDawg::removeInterned(const vector<NodeMasses> & sequence){
+    // only kmers that were inserted can be removed, not the prefixes they hold
+    uint32_t kmer = this->prefixIds.back();
+    if (kmer >= this->insertions.size() || this->insertions[kmer] == 0) return false;
+
+    // every node has to be merged to be found by its masses alone
+    this->finish();
+
+    // path[i + 1] is the node the insertion reached at position i
+    vector<MassDawgNode *> path {this->root};
+    for (int i = 0; i < (int)sequence.size(); i++){
+        MassDawgNode * child = path.back()->findChild(sequence[i]);
+        if (child == nullptr || child->kmerCount(this->prefixIds[i]) == 0) return false;
+
+        path.push_back(child);
+    }
+    this->insertions[kmer] --;
+
+    // take the insertion off of every edge it took and every kmer it added
+    for (int i = 0; i < (int)sequence.size(); i++){
+        path[i]->unlinkChild(path[i + 1]);
+        path[i + 1]->removeKmer(this->prefixIds[i]);
+    }
+
+    // a node left with no kmers is reached by no insertion, so every edge to and 
+    // from it is gone too. A node on the path more than once is only released once
+    for (int i = 1; i < (int)path.size(); i++){
+        MassDawgNode * node = path[i];
+        if (!node->kmers.empty() || this->minimizedNodes.find(node->masses) != node) continue;
+
+        this->minimizedNodes.remove(node);
+        this->arena.release(node);
+    }
+    return true;
+}
+
 /**
  * Any remaining unchecked nodes will be checked for merging to 
- * complete the dawg. 
+ * complete the dawg. More sequences can be inserted afterwards,
+ * and are merged into the finished graph by the next finish
 */
 void MassDawg::finish(){
     this->minimize(0);
+
+    // nodes of the last sequence may have been merged away and given back to
+    // the arena, so the next insertion finds its prefix from the root instead
+    this->previousSequence = PreviousSequence();
+}
+
+/**
+ * Walk the graph and measure its size and shape
+ * 
+ * @return MassDawgStats    the node, edge and kmer counts, bytes used, fanout
+ *                          and depth histograms and the merge ratio
+*/
+MassDawgStats MassDawg::stats() const {
+    MassDawgStats stats;
+    stats.nodes = 0;
+    stats.edges = 0;
+    stats.kmers = 0;
+    stats.kmerIdBytes = 0;
+    stats.childrenBytes = 0;
+
+    // removed kmers stay in the table, so only the ids some node holds are counted
+    vector<bool> held(this->kmers.size(), false);
+
+    // breadth first, so the first time a node is reached is by its shortest path
+    unordered_map<const MassDawgNode *, int> depths;
+    vector<const MassDawgNode *> queue {this->root};
+    depths[this->root] = 0;
+
+    for (int i = 0; i < (int)queue.size(); i++){
+        const MassDawgNode * node = queue[i];
+        int depth = depths[node];
+        int fanout = (int)node->children.size();
+
+        stats.nodes ++;
+        stats.edges += fanout;
+        stats.kmerIdBytes += (node->kmers.capacity() + node->kmerCounts.capacity()) * sizeof(uint32_t);
+        stats.childrenBytes += node->children.capacity() * sizeof(MassDawgNode *) + node->childCounts.capacity() * sizeof(uint32_t);
+
+        for (uint32_t kmer: node->kmers){
+            if (!held[kmer]) stats.kmers ++;
+            held[kmer] = true;
+        }
+
+        if ((int)stats.fanoutHistogram.size() <= fanout) stats.fanoutHistogram.resize(fanout + 1, 0);
+        stats.fanoutHistogram[fanout] ++;
+        if ((int)stats.depthHistogram.size() <= depth) stats.depthHistogram.resize(depth + 1, 0);
+        stats.depthHistogram[depth] ++;
+
+        for (const MassDawgNode * child: node->children){
+            if (depths.find(child) != depths.end()) continue;
+
+            depths[child] = depth + 1;
+            queue.push_back(child);
+        }
+    }
+
+    stats.nodeBytes = this->arena.memoryUsage();
+    stats.kmerTableBytes = this->kmers.memoryUsage();
+    stats.minimizedNodesBytes = this->minimizedNodes.memoryUsage();
+    stats.deadKmers = this->kmers.size() - stats.kmers;
+
+    // every distinct prefix is one node of a trie
+    stats.mergeRatio = stats.nodes > 1 ? (double)stats.kmers / (stats.nodes - 1) : 0;
+
+    return stats;
 }
 
 /**
@@ -139,26 +502,74 @@ void MassDawg::finish(){
  * @param sequence      vector<float>  the sequence to search 
  * @param gapAllowance  int             The number of gaps to allow in the search
  * @param ppmTol        int             the tolerance in parts per million to accept when searching
+ * @param stats         SearchStats *   counters to fill in, only when built with MASSDAWG_SEARCH_STATS
  * 
  * @return vector<string>               All kmers that we found in the search
 */
-vector<string> MassDawg::fuzzySearch(vector<float> sequence, int gapAllowance, int ppmTol){
-    // save all results from all children into a vector
-    vector<vector<string> > allResults;
-    for (int i = 0; i < (int)this->root->children.size(); i ++) 
-        allResults.push_back(this->fuzzySearchRec(sequence, this->root->children[i], 0, gapAllowance, ppmTol));
-
-    // combine them all into one vector
-    vector<string> mergedResults;
-    for (int i = 0; i < (int)allResults.size(); i++){
-        for (int j = 0; j < (int)allResults[i].size(); j++){
-            if (allResults[i][j].empty()) continue;
-            mergedResults.push_back(allResults[i][j]);
-        } 
-    }
+vector<string> MassDawg::fuzzySearch(const vector<float> & sequence, int gapAllowance, int ppmTol, SearchStats * stats) const {
+    return this->fuzzySearch(sequence.data(), (int)sequence.size(), gapAllowance, ppmTol, stats);
+}
+
+/**
+ * Same as fuzzySearch, for a sequence in an array of masses
+ * 
+ * @param sequence      const float *   the sequence to search
+ * @param length        int             the number of masses in sequence
+ * @param gapAllowance  int             The number of gaps to allow in the search
+ * @param ppmTol        int             the tolerance in parts per million to accept when searching
+ * @param stats         SearchStats *   counters to fill in, only when built with MASSDAWG_SEARCH_STATS
+ * 
+ * @return vector<string>               All kmers that we found in the search
+*/
+vector<string> MassDawg::fuzzySearch(const float * sequence, int length, int gapAllowance, int ppmTol, SearchStats * stats) const {
+    return fuzzySearchGraph(MassDawgNodeView(this->root, &this->kmers), sequence, length, gapAllowance, ppmTol, stats);
+}
+
+/**
+ * Same as fuzzySearch, but remembers the results of every node for the peaks
+ * it was reached with. Minimizing merges shared suffixes into one node with many
+ * parents, so when another path reaches the node with the same peaks left and
+ * gaps used, its results are reused instead of searching under it again
+ * 
+ * @param sequence      vector<float>   the sequence to search
+ * @param gapAllowance  int             The number of gaps to allow in the search
+ * @param ppmTol        int             the tolerance in parts per million to accept when searching
+ * @param stats         SearchStats *   counters to fill in, only when built with MASSDAWG_SEARCH_STATS
+ * 
+ * @return vector<string>               the same kmers in the same order as fuzzySearch
+*/
+vector<string> MassDawg::memoizedFuzzySearch(const vector<float> & sequence, int gapAllowance, int ppmTol, SearchStats * stats) const {
+    return this->memoizedFuzzySearch(sequence.data(), (int)sequence.size(), gapAllowance, ppmTol, stats);
+}
 
-    return mergedResults;
+/**
+ * Same as memoizedFuzzySearch, for a sequence in an array of masses
+ * 
+ * @param sequence      const float *   the sequence to search
+ * @param length        int             the number of masses in sequence
+ * @param gapAllowance  int             The number of gaps to allow in the search
+ * @param ppmTol        int             the tolerance in parts per million to accept when searching
+ * @param stats         SearchStats *   counters to fill in, only when built with MASSDAWG_SEARCH_STATS
+ * 
+ * @return vector<string>               the same kmers in the same order as fuzzySearch
+*/
+vector<string> MassDawg::memoizedFuzzySearch(const float * sequence, int length, int gapAllowance, int ppmTol, SearchStats * stats) const {
+    return fuzzySearchGraph(MassDawgNodeView(this->root, &this->kmers), sequence, length, gapAllowance, ppmTol, stats, true);
+}
 
+/**
+ * Fuzzy search many spectra at once over a pool of threads. The graph is
+ * only read, so it must not be changed while this runs
+ *
+ * @param spectra       vector<vector<float>>   the sequences to search
+ * @param gapAllowance  int                     The number of gaps to allow in the search
+ * @param ppmTol        int                     the tolerance in parts per million to accept when searching
+ * @param threads       int                     the number of threads to use. If < 1, one per core is used
+ *
+ * @return vector<vector<string>>   the kmers found for each spectrum, in the same order as spectra
+*/
+vector<vector<string> > MassDawg::batchFuzzySearch(const vector<vector<float> > & spectra, int gapAllowance, int ppmTol, int threads) const {
+    return batchFuzzySearchGraph(MassDawgNodeView(this->root, &this->kmers), spectra, gapAllowance, ppmTol, threads);
 }
 
 /**
@@ -166,84 +577,70 @@ vector<string> MassDawg::fuzzySearch(vector<float> sequence, int gapAllowance, i
 * 
 * @param sequence       vector<float>   the sequence to search
 * @param ppmTol         int             the tolerance in parts per million to accept when searching
+* @param stats          SearchStats *   counters to fill in, only when built with MASSDAWG_SEARCH_STATS
 * 
 * @return vector<string>                All kmers that we found in the search
 */
-vector<string> MassDawg::search(vector<float> sequence, int ppmTol){
-    MassDawgNode * currentNode = this->root;
-
-    if (sequence.empty()) return vector<string> {};
-
-    while (true){
-
-        // collect all the children that have a mass and take the one with the lowest masses
-        vector<MassDawgNode *> candidates;
-
-        // go through each child and see if the masses fit the tolerance
-        for (MassDawgNode * child: currentNode->children){
-            // check to see if any of the values in the sequence are within
-            // the range of the singly and doubly masses within this node
-            float singlyDaTol = ppmToDa(child->singlyMass, ppmTol);
-            float doublyDaTol = ppmToDa(child->doublyMass, ppmTol);
-
-            // calcuate the bounds
-            float singlyLowerBound = child->singlyMass - singlyDaTol;
-            float singlyUpperBound = child->singlyMass + singlyDaTol;
-            float doublyLowerBound = child->doublyMass - doublyDaTol;
-            float doublyUpperBound = child->doublyMass + doublyDaTol;
-
-            // if any of the masses in the sequence are within this tolerance, we will 
-            // continue with this child.
-            bool massFound = false;
-
-            // go through each mass in the sequence and see if any of the values are in 
-            // either set of bounds
-            for (int i = 0; i < (int)sequence.size(); i++){
-                if ((singlyLowerBound <= sequence[i] && sequence[i] <= singlyUpperBound) 
-                || (doublyLowerBound <= sequence[i] && sequence[i] <= doublyUpperBound)){
-                    massFound = true;
-                    break;
-                }
-            }
-
-            if (!massFound) continue;
-            
-            candidates.push_back(child);
-        }
-
-        if (candidates.empty()) break;
-
-        // find the candidate with the smallest mass
-        int indexOfSmallest = 0;
-        float smallestMass = candidates.front()->singlyMass;
-        for (int i = 1; i < (int)candidates.size(); i++){
-            if (candidates[i]->singlyMass < smallestMass){
-                indexOfSmallest = i;
-                smallestMass = candidates[i]->singlyMass;
-            }
-        }
-
-        //the child at indexOfSmallest is our new currentNode and we need to update the sequence 
-        // to not include masses that the child has
-        vector<float> updatedSequence;
-        float doublyDaTol = ppmToDa(candidates[indexOfSmallest]->doublyMass, ppmTol);
-        float singlyDaTol = ppmToDa(candidates[indexOfSmallest]->singlyMass, ppmTol);
+vector<string> MassDawg::search(const vector<float> & sequence, int ppmTol, SearchStats * stats) const {
+    return this->search(sequence.data(), (int)sequence.size(), ppmTol, stats);
+}
 
-        for (float mass: sequence){
-            if (mass <= candidates[indexOfSmallest]->doublyMass + doublyDaTol || 
-            (mass >= candidates[indexOfSmallest]->singlyMass - singlyDaTol &&
-            mass <= candidates[indexOfSmallest]->singlyMass + singlyDaTol)) continue;
+/**
+* Same as search, for a sequence in an array of masses
+* 
+* @param sequence       const float *   the sequence to search
+* @param length         int             the number of masses in sequence
+* @param ppmTol         int             the tolerance in parts per million to accept when searching
+* @param stats          SearchStats *   counters to fill in, only when built with MASSDAWG_SEARCH_STATS
+* 
+* @return vector<string>                All kmers that we found in the search
+*/
+vector<string> MassDawg::search(const float * sequence, int length, int ppmTol, SearchStats * stats) const {
+    return searchGraph(MassDawgNodeView(this->root, &this->kmers), sequence, length, ppmTol, stats);
+}
 
-            updatedSequence.push_back(mass);
-        }
+/**
+ * Search like fuzzySearch, scoring every path by the masses it matches (or
+ * the sum of their intensities) and returning only the k best kmers. Branches
+ * that can not beat the kth best kmer found so far are not searched
+ *
+ * @param sequence      vector<float>   the sequence to search
+ * @param k             int             the number of kmers to return
+ * @param gapAllowance  int             The number of gaps to allow in the search
+ * @param ppmTol        int             the tolerance in parts per million to accept when searching
+ * @param intensities   vector<float>   the intensity of each mass in sequence. If empty, matched masses are counted
+ * @param stats         SearchStats *   counters to fill in, only when built with MASSDAWG_SEARCH_STATS
+ *
+ * @return vector<ScoredKmer>           up to k kmers, best score first
+ *
+ * @throws invalid_argument    if intensities is not empty or the length of sequence, or has a negative intensity
+*/
+vector<ScoredKmer> MassDawg::topKSearch(const vector<float> & sequence, int k, int gapAllowance, int ppmTol, 
+    const vector<float> & intensities, SearchStats * stats) const {
+    if (!intensities.empty() && intensities.size() != sequence.size()) throw invalid_argument("intensities must be empty or the same length as the sequence");
 
-        currentNode = candidates[indexOfSmallest];
-        sequence = updatedSequence;
-    }
+    return this->topKSearch(sequence.data(), intensities.empty() ? nullptr : intensities.data(), (int)sequence.size(), k, gapAllowance, ppmTol, stats);
+}
 
-    return currentNode->kmers;
-    
-  }
+/**
+ * Same as topKSearch, for a sequence in an array of masses
+ *
+ * @param sequence      const float *   the sequence to search
+ * @param intensities   const float *   the intensity of each mass in sequence, or null to count matched masses
+ * @param length        int             the number of masses in sequence
+ * @param k             int             the number of kmers to return
+ * @param gapAllowance  int             The number of gaps to allow in the search
+ * @param ppmTol        int             the tolerance in parts per million to accept when searching
+ * @param stats         SearchStats *   counters to fill in, only when built with MASSDAWG_SEARCH_STATS
+ *
+ * @return vector<ScoredKmer>           up to k kmers, best score first
+ *
+ * @throws invalid_argument    if an intensity is negative
+*/
+vector<ScoredKmer> MassDawg::topKSearch(const float * sequence, const float * intensities, int length, int k, int gapAllowance, int ppmTol, 
+    SearchStats * stats) const {
+    return topKSearchGraph(MassDawgNodeView(this->root, &this->kmers), sequence, intensities, length, k, gapAllowance, ppmTol, stats);
+}
 
 
 
@@ -251,66 +648,55 @@ vector<string> MassDawg::search(vector<float> sequence, int ppmTol){
 
 
 
+// count one more insertion of the kmer whose prefix ids are in prefixIds
+void MassDawg::countInsertion(){
+    if (this->insertions.size() < (size_t)this->kmers.size()) this->insertions.resize(this->kmers.size(), 0);
+    this->insertions[this->prefixIds.back()] ++;
+}
+
 /**
  * What makes this a graph and not a tree. Combines nodes that share edges and values
  * 
- * @param downTo    int     the level down to which we need to minimize 
+ * @param downTo    int     unchecked nodes at this depth and deeper are minimized
 */
 void MassDawg::minimize(int downTo){
-    if ((int)this->uncheckedNodes.size() == 0) return;
-
-    // go through all of the unckecked nodes that exist and see if we can merge any
-    for (int i = (int)this->uncheckedNodes.size() - 1; i > downTo - 1; i--){
+    // go through all of the unckecked nodes at or below downTo and see if we can merge any
+    while (!this->uncheckedNodes.empty() && this->uncheckedNodes.back().depth >= downTo){
 
         // local variables to make things easier
         UncheckedNode currentUnchecked = this->uncheckedNodes.back();
         MassDawgNode * child = currentUnchecked.child;
         MassDawgNode * parent = currentUnchecked.parent;
 
-        // get the hashable value of the child 
-        string childsHash = child->hash();
-
-        // check to see if this value can be found
-        unordered_map<string, MassDawgNode *>::const_iterator result = this->minimizedNodes.find(childsHash);
+        // check to see if a node with the same masses can be found
+        MassDawgNode * minimizedNode = this->minimizedNodes.find(child->masses);
         
         // if the node is not in the map, add it
-        if (result == this->minimizedNodes.end()){
-            this->minimizedNodes.insert({childsHash, child});
+        if (minimizedNode == nullptr){
+            this->minimizedNodes.insert(child);
         }
 
         // Parent contains child in one of its children. we need to point
         // this to the node in the map (map has a pointer, so just set parent[child]->child to map return)
         // and delete child. Add all the kmers of the child to the one in the map
         else {
-            // get the pointer from the map
-            MassDawgNode * minimizedNode = result->second;
-
-            // set add all the kmers in the child to the node
-            for (string kmer: child->kmers){
-                minimizedNode->addKmer(kmer);
+            // set add all the kmers in the child to the node, with the insertions
+            // that reached each one
+            for (int i = 0; i < (int)child->kmers.size(); i++){
+                minimizedNode->addKmer(child->kmers[i], child->kmerCountAt(i));
             }
            
             // add all the children of the current child node to the minimized node
-            for (MassDawgNode * childsChild: child->children){
-                minimizedNode->addChildByPointer(childsChild);
+            for (int i = 0; i < (int)child->children.size(); i++){
+                minimizedNode->addChildByPointer(child->children[i], child->childCountAt(i));
             }
             
             // find the child of the parent that pointed to the node
             // and update that pointer to point to minimizedNode
-            for (int j = 0; j < (int)parent->children.size(); j ++){
-                if (parent->children[j] == child) {
-                    parent->children[j] = minimizedNode;
-                    break;
-                }
-            }
+            parent->replaceChild(child, minimizedNode);
             
-            // delete child
-            try {
-                delete child;
-            }
-            catch (exception){
-                cout << "Error when deleting child in MassDawg";
-            }
+            // give child back to the arena to be reused
+            this->arena.release(child);
         }
 
         // remove the one we just finished working on
@@ -319,129 +705,76 @@ void MassDawg::minimize(int downTo){
 }
 
 /**
- * Recursive search of the graph allowing for gapAllowance missed masses in the
- * search before returning whatever is found at the level
- * 
- * @param sequence      vector<float>  The sequence to use to navigate the graph
- * @param currentNode   MassDawgNode *  The current node to investigate
- * @param currentGap    int             The number of gaps we have allowed up until this point
- * @param gapAllowance  int             The total number of gaps to allow
+ * Copy a finished shard into this finished graph. Shard nodes with the masses of a
+ * node already in the graph are combined with it, the rest are added as new nodes.
+ * The kmer ids of the shard must be ids of this graph's kmers
  * 
- * @return vector<string>   The kmers associated with the deepest part of the branch investigated
+ * @param shard     const MassDawg &    the graph to merge in
 */
-vector<string> MassDawg::fuzzySearchRec(vector<float> sequence, MassDawgNode * currentNode, int currentGap, int gapAllowance, int ppmTol){
-    // for the cases when we return nothing
-    vector<string> emptyResult = {""};
-
-    // BASE CASE: we're past our limit
-    if ((gapAllowance - currentGap) < 0) return emptyResult;
-
-    // BASE CASE: we're given an empty sequence
-    if (sequence.empty()) return emptyResult;
-
-    // check to see if any of the values in the sequence are within
-    // the range of the singly and doubly masses within this node
-    float singlyDaTol = ppmToDa(currentNode->singlyMass, ppmTol);
-    float doublyDaTol = ppmToDa(currentNode->doublyMass, ppmTol);
-
-    // calcuate the bounds
-    float singlyLowerBound = currentNode->singlyMass - singlyDaTol;
-    float singlyUpperBound = currentNode->singlyMass + singlyDaTol;
-    float doublyLowerBound = currentNode->doublyMass - doublyDaTol;
-    float doublyUpperBound = currentNode->doublyMass + doublyDaTol;
-
-    bool massFound = false;
-    // go through each mass in the sequence and see if any of the values are in 
-    // either set of bounds
-    for (int i = 0; i < (int)sequence.size(); i++){
-        if ((singlyLowerBound <= sequence[i] && sequence[i] <= singlyUpperBound) 
-        || (doublyLowerBound <= sequence[i] && sequence[i] <= doublyUpperBound)){
-            massFound = true;
-            break;
-        }
-    }
-
-    // add to the gap if we didnt find the mass
-    int gapAddition = massFound ? 0 : 1;
+void MassDawg::merge(const MassDawg & shard){
+    // the node of this graph that each visited shard node was merged into
+    unordered_map<const MassDawgNode *, MassDawgNode *> mergedInto;
+    mergedInto[shard.root] = this->root;
+
+    vector<const MassDawgNode *> stack = {shard.root};
+    while (!stack.empty()){
+        const MassDawgNode * node = stack.back();
+        stack.pop_back();
+        MassDawgNode * target = mergedInto[node];
+
+        for (int i = 0; i < (int)node->children.size(); i++){
+            MassDawgNode * child = node->children[i];
+            auto found = mergedInto.find(child);
+            MassDawgNode * childTarget;
+
+            if (found != mergedInto.end()) childTarget = found->second;
+            else {
+                // every node of a finished graph is in the map, so a node with the
+                // same masses is the one to combine with
+                childTarget = this->minimizedNodes.find(child->masses);
+
+                if (childTarget == nullptr){
+                    childTarget = this->arena.allocate();
+                    childTarget->masses = child->masses;
+                    this->minimizedNodes.insert(childTarget);
+                }
 
-    // updated vector. Won't change if mass wasn't found
-    vector<float> updatedSequence;
+                for (int k = 0; k < (int)child->kmers.size(); k++) childTarget->addKmer(child->kmers[k], child->kmerCountAt(k));
 
-    // if we found the mass, update sequence to not contain
-    // any of the masses < our doubly lower bound and any masses in our singly range
-    if (massFound) {
-        for (int i = 0; i < (int)sequence.size(); i ++){
-            if ((singlyLowerBound <= sequence[i] && sequence[i] <= singlyUpperBound) 
-            || (doublyLowerBound <= sequence[i] && sequence[i] <= doublyUpperBound)){
-                continue;
+                mergedInto[child] = childTarget;
+                stack.push_back(child);
             }
 
-            //otherwise keep it
-            updatedSequence.push_back(sequence[i]);
+            target->linkChild(childTarget, node->childCountAt(i));
         }
     }
-    else updatedSequence = sequence;
-
-    // if our updated sequence is EMPTY but we found the mass, return my kmers
-    if (updatedSequence.empty() and massFound) return vector<string>(currentNode->kmers);
-
-    // otherwise go through all of the children and save their results
-    vector<vector<string> > childrensResults;
-    for (int i = 0; i < (int)currentNode->children.size(); i++){
-        childrensResults.push_back(this->fuzzySearchRec(
-            updatedSequence, 
-            currentNode->children[i], 
-            currentGap + gapAddition, 
-            gapAllowance, 
-            ppmTol
-        ));
-    }
-
-    // combine all the children's return values into one vector
-    vector<string> results;
-    for (int i = 0; i < (int)childrensResults.size(); i++){
-        for (int j = 0; j < (int)childrensResults[i].size(); j++){
-            if (childrensResults[i][j].empty()) continue;
-            results.push_back(childrensResults[i][j]);
-        }
-    }
-
-    // if we don't have any results and we found a mass, return my results
-    if (results.empty() && massFound) return vector<string>(currentNode->kmers);
-
-    // otherwise return results
-    return results.empty() ? emptyResult : results;
 }
 
 /**	
- * Checks to see if the new sequences are greater than the old previous sequence	
+ * Checks to see if the new sequence is greater than the old previous sequence	
  * 	
- * @param singlySequence    vector<float>  the new sequence of singly charged masses	
- * @param doublySequence    vector<float>  the new sequence of doubly charged masses	
+ * @param sequence      vector<NodeMasses>  the new sequence of masses at every charge	
  * 	
- * @return bool     True if the new sequences are greater than the prvious, False otherwise	
+ * @return bool     True if the new sequence is greater than the prvious, False otherwise	
 */	
-bool MassDawg::previousIsLessThan(vector<float> singlySequence, vector<float> doublySequence){	
+bool MassDawg::previousIsLessThan(const vector<NodeMasses> & sequence){	
     // get the lengths of each and determine the shorter one	
-    int newLength = (int)singlySequence.size();	
-    int oldLength = (int)this->previousSequence.singlySequence.size();	
+    int newLength = (int)sequence.size();	
+    int oldLength = (int)this->previousSequence.sequence.size();	
 
     int iterLength = MIN(newLength, oldLength);	
 
     for (int i = 0; i < iterLength; i ++){	
-
-        // if the new one in either the singly OR doubly	
-        // is greater than the previous at i, retutn False	
-        if ((singlySequence[i] < this->previousSequence.singlySequence[i])	
-        || (doublySequence[i] < this->previousSequence.doublySequence[i])){	
-            return false;	
-        }	
-
-        // if the new one is greater than the old one, return true	
-        if ((singlySequence[i] > this->previousSequence.singlySequence[i])	
-        && (doublySequence[i] > this->previousSequence.doublySequence[i])){	
-            return true;	
-        }	
+        const NodeMasses & previous = this->previousSequence.sequence[i];
+
+        // if the new one at any charge is less than the previous at i, return False	
+        // and if it is greater at every charge, return true	
+        bool allGreater = true;
+        for (int z = 0; z < NodeMasses::charges; z++){
+            if (sequence[i][z] < previous[z]) return false;
+            allGreater = allGreater && sequence[i][z] > previous[z];
+        }
+        if (allGreater) return true;
     }	
 
     return newLength >= oldLength;	
@@ -451,50 +784,24 @@ bool MassDawg::previousIsLessThan(vector<float> singlySequence, vector<float> do
  * Find the longest common prefix of input sequences to a path in the tree. Used for out
  * of order insertions.
  * 
- * @param singlySequence    vector<float>   the singly sequence we are looking for a prefix of
- * @param doublySequence    vector<float>   the doubly sequence we are looking for a prefix of
+ * @param sequence      vector<NodeMasses>  the sequence we are looking for a prefix of
  * 
  * @returns LongestCommonPrefix *   the class instance holding the longest common prefixe
 */
-LongestCommonPrefix MassDawg::longestCommonPrefix(vector<float> singlySequence, vector<float> doublySequence){
-    // first check to see if we should return the root
-    bool rootHasChild = false;
-    float delta = .0001;
-    for (MassDawgNode * child: root->children){
-        if (abs(child->singlyMass - singlySequence[0]) < delta && abs(child->doublyMass - doublySequence[0]) < delta){
-            rootHasChild = true;
-            break;
-        }
-    }
-
-    // if the root does not have a child
-    if (!rootHasChild){
-        return LongestCommonPrefix(vector<float> {}, vector<float> {}, vector<MassDawgNode *> {this->root});
-    }
-
+LongestCommonPrefix MassDawg::longestCommonPrefix(const vector<NodeMasses> & sequence){
     MassDawgNode * currentNode = this->root;
-    LongestCommonPrefix lcp(vector<float> {}, vector<float> {}, vector<MassDawgNode *> {});
-    for (int i = 0; i < (int)singlySequence.size(); i++){
-        // go through the current node's children, and if the child has a node that meets the weight at i,
-        // add it ot the list
-
-        // keep track if we continued the common prefix
-        bool extended = false;
-
-        for (MassDawgNode * child: currentNode->children){
-
-            // if both the singly and doubly sequence were found, add it to the list and end this loop
-            if (abs(child->singlyMass - singlySequence[i]) < delta && abs(child->doublyMass - doublySequence[i]) < delta){
-                lcp.nodes.push_back(child);
-                lcp.singlySequence.push_back(singlySequence[i]);
-                lcp.doublySequence.push_back(doublySequence[i]);
-                extended = true;
-                break;
-            }
-        }
+    LongestCommonPrefix lcp(vector<NodeMasses> {}, vector<MassDawgNode *> {});
+
+    for (int i = 0; i < (int)sequence.size(); i++){
+        // find the child of the current node with the masses at i
+        MassDawgNode * child = currentNode->findChild(sequence[i]);
 
         // if we didn't extend, break
-        if (!extended) break;
+        if (child == nullptr) break;
+
+        lcp.nodes.push_back(child);
+        lcp.sequence.push_back(sequence[i]);
+        currentNode = child;
     }
     return lcp;
 }
@@ -3,12 +3,16 @@
 
 #define MIN(a, b)       (a > b ? b : a)    
 
-#include <unordered_map>
 #include <list>
 #include <vector>
 #include <iostream>
 
 #include "MassDawgNode.hpp"
+#include "MassDawgNodeArena.hpp"
+#include "KmerTable.hpp"
+#include "MinimizedNodeMap.hpp"
+#include "SearchStats.hpp"
+#include "ScoredKmer.hpp"
 
 using namespace std;
 
@@ -16,6 +20,8 @@ class UncheckedNode {
 public:
     MassDawgNode * parent;
     MassDawgNode * child;
+    // the position of child in the sequence it was inserted with
+    int depth;
 
     UncheckedNode(){}
 
@@ -24,8 +30,7 @@ public:
 
 class PreviousSequence {
 public: 
-    vector<float> singlySequence;
-    vector<float> doublySequence;
+    vector<NodeMasses> sequence;
     vector<MassDawgNode *> nodes;
 
     PreviousSequence() {}
@@ -35,16 +40,52 @@ public:
 
 class LongestCommonPrefix {
 public:
-    vector<float> singlySequence;
-    vector<float> doublySequence;
+    vector<NodeMasses> sequence;
     vector<MassDawgNode *> nodes;
 
     LongestCommonPrefix() {}
-    LongestCommonPrefix(vector<float> sS, vector<float> dS, vector<MassDawgNode *> nodes);
+    LongestCommonPrefix(vector<NodeMasses> sequence, vector<MassDawgNode *> nodes);
 
     ~LongestCommonPrefix() {}
 };
 
+// the size and shape of a MassDawg, see MassDawg::stats
+class MassDawgStats {
+public:
+    // nodes reachable from the root (including the root) and the edges between them
+    int nodes;
+    int edges;
+    // distinct kmers and prefixes of kmers in the graph
+    int kmers;
+    // kmers that were removed, whose ids and characters stay in the kmer table
+    // until the graph is frozen, which leaves them out
+    int deadKmers;
+
+    // bytes used by the node slabs, the kmer id and children vectors of the nodes
+    // (with their insertion counts), the kmer strings and the map of minimized nodes
+    size_t nodeBytes;
+    size_t kmerIdBytes;
+    size_t childrenBytes;
+    size_t kmerTableBytes;
+    size_t minimizedNodesBytes;
+
+    // fanoutHistogram[i] is the number of nodes with i children
+    vector<int> fanoutHistogram;
+    // depthHistogram[d] is the number of nodes whose shortest path from the root has d edges
+    vector<int> depthHistogram;
+
+    // the number of nodes a trie of the same kmers would have for every node (other
+    // than the root) of the graph. Higher is better compression by minimize
+    double mergeRatio;
+
+    MassDawgStats(){}
+
+    ~MassDawgStats(){}
+
+    // the sum of all of the bytes
+    size_t totalBytes() const { return nodeBytes + kmerIdBytes + childrenBytes + kmerTableBytes + minimizedNodesBytes; }
+};
+
 class MassDawg{
 public:
     // empty constructor takes no values
@@ -67,6 +108,91 @@ public:
     */
     void insert(vector<float> singlySequence, vector<float> doublySequence, string kmer);
 
+    /**
+     * Add a new singly and doubly charged sequence associated with the kmer to the graph
+     * from arrays of masses, such as the buffers of numpy arrays
+     * 
+     * @param singlySequence    const float *   the singly charged sequence of masses
+     * @param doublySequence    const float *   the doubly charged sequence of masses
+     * @param length            int             the number of masses in each sequence
+     * @param kmer              string          the sequence of amino acids associated with this mass
+    */
+    void insert(const float * singlySequence, const float * doublySequence, int length, const string & kmer);
+
+    /**
+     * Add a new sequence associated with the kmer to the graph from the masses of
+     * each node already in fixed point units, which are inserted as they are
+     * 
+     * @param sequence      const NodeMasses *  the masses at every charge of each node
+     * @param length        int                 the number of nodes in the sequence
+     * @param kmer          string              the sequence of amino acids associated with this mass
+    */
+    void insert(const NodeMasses * sequence, int length, const string & kmer);
+
+    /**
+     * Add many sequences at once, building them over a pool of threads. The kmers are
+     * split into shards by the masses of their first edge (the child of the root they
+     * hang off of), each shard is built and minimized as its own graph on a thread and
+     * the shards are then merged under the root, combining nodes with the same masses
+     * across shards. Any earlier insertions are finished first and the graph is
+     * finished afterwards
+     * 
+     * @param singlySequences   vector<vector<float>>   the singly charged sequence of masses of each kmer
+     * @param doublySequences   vector<vector<float>>   the doubly charged sequence of masses of each kmer
+     * @param kmers             vector<string>          the sequences of amino acids associated with the masses
+     * @param threads           int                     the number of threads to use. If < 1, one per core is used
+    */
+    void parallelInsert(const vector<vector<float> > & singlySequences, const vector<vector<float> > & doublySequences, const vector<string> & kmers, int threads);
+
+    /**
+     * Remove one insertion of a singly and doubly charged sequence and its kmer from
+     * the graph, undoing the insert made with the same masses and kmer. The kmer stays
+     * in the graph until it has been removed as many times as it was inserted. Nodes
+     * no other insertion reaches are pruned, so the graph stays minimized, and only the
+     * nodes of the sequence are visited. Any unchecked nodes are merged first
+     * 
+     * @param singlySequence    vector<float>   the singly charged sequence of masses it was inserted with
+     * @param doublySequence    vector<float>   the doubly charged sequence of masses it was inserted with
+     * @param kmer              string          the sequence of amino acids it was inserted with
+     * 
+     * @return bool     True if the sequence was in the graph and was removed, False otherwise
+    */
+    bool remove(vector<float> singlySequence, vector<float> doublySequence, string kmer);
+
+    /**
+     * Remove one insertion of a singly and doubly charged sequence and its kmer from
+     * the graph from arrays of masses, such as the buffers of numpy arrays
+     * 
+     * @param singlySequence    const float *   the singly charged sequence of masses it was inserted with
+     * @param doublySequence    const float *   the doubly charged sequence of masses it was inserted with
+     * @param length            int             the number of masses in each sequence
+     * @param kmer              string          the sequence of amino acids it was inserted with
+     * 
+     * @return bool     True if the sequence was in the graph and was removed, False otherwise
+    */
+    bool remove(const float * singlySequence, const float * doublySequence, int length, const string & kmer);
+
+    /**
+     * Remove one insertion of a sequence and its kmer from the graph with the masses
+     * of each node already in fixed point units
+     * 
+     * @param sequence      const NodeMasses *  the masses at every charge of each node it was inserted with
+     * @param length        int                 the number of nodes in the sequence
+     * @param kmer          string              the sequence of amino acids it was inserted with
+     * 
+     * @return bool     True if the sequence was in the graph and was removed, False otherwise
+    */
+    bool remove(const NodeMasses * sequence, int length, const string & kmer);
+
+    /**
+     * Count the insertions of a kmer that have not been removed
+     * 
+     * @param kmer      string      the sequence of amino acids
+     * 
+     * @return int      the number of times the kmer is in the graph, 0 if it is not
+    */
+    int insertionCount(const string & kmer) const;
+
     /**
      * Search for the input sequence while allowing for up to gapAllowances
      * before the search returns however deep it is in the graph
@@ -74,74 +200,212 @@ public:
      * @param sequence      vector<float>   the sequence to search 
      * @param gapAllowance  int             The number of gaps to allow in the search
      * @param ppmTol        int             the tolerance in parts per million to accept when searching
+     * @param stats         SearchStats *   counters to fill in, only when built with MASSDAWG_SEARCH_STATS
      * 
      * @return vector<string>               All kmers that we found in the search
     */
-   vector<string> fuzzySearch(vector<float> sequence, int gapAllowance, int ppmTol);
+   vector<string> fuzzySearch(const vector<float> & sequence, int gapAllowance, int ppmTol, SearchStats * stats = nullptr) const;
+
+   /**
+    * Same as fuzzySearch, for a sequence in an array of masses
+    * 
+    * @param sequence      const float *   the sequence to search
+    * @param length        int             the number of masses in sequence
+    * @param gapAllowance  int             The number of gaps to allow in the search
+    * @param ppmTol        int             the tolerance in parts per million to accept when searching
+    * @param stats         SearchStats *   counters to fill in, only when built with MASSDAWG_SEARCH_STATS
+    * 
+    * @return vector<string>               All kmers that we found in the search
+   */
+   vector<string> fuzzySearch(const float * sequence, int length, int gapAllowance, int ppmTol, SearchStats * stats = nullptr) const;
+
+   /**
+    * Same as fuzzySearch, but remembers the results of every node for the peaks
+    * it was reached with. Minimizing merges shared suffixes into one node with many
+    * parents, so when another path reaches the node with the same peaks left and
+    * gaps used, its results are reused instead of searching under it again
+    * 
+    * @param sequence      vector<float>   the sequence to search
+    * @param gapAllowance  int             The number of gaps to allow in the search
+    * @param ppmTol        int             the tolerance in parts per million to accept when searching
+    * @param stats         SearchStats *   counters to fill in, only when built with MASSDAWG_SEARCH_STATS
+    * 
+    * @return vector<string>               the same kmers in the same order as fuzzySearch
+   */
+   vector<string> memoizedFuzzySearch(const vector<float> & sequence, int gapAllowance, int ppmTol, SearchStats * stats = nullptr) const;
+
+   /**
+    * Same as memoizedFuzzySearch, for a sequence in an array of masses
+    * 
+    * @param sequence      const float *   the sequence to search
+    * @param length        int             the number of masses in sequence
+    * @param gapAllowance  int             The number of gaps to allow in the search
+    * @param ppmTol        int             the tolerance in parts per million to accept when searching
+    * @param stats         SearchStats *   counters to fill in, only when built with MASSDAWG_SEARCH_STATS
+    * 
+    * @return vector<string>               the same kmers in the same order as fuzzySearch
+   */
+   vector<string> memoizedFuzzySearch(const float * sequence, int length, int gapAllowance, int ppmTol, SearchStats * stats = nullptr) const;
+
+   /**
+    * Fuzzy search many spectra at once over a pool of threads. The graph is
+    * only read, so it must not be changed while this runs
+    *
+    * @param spectra       vector<vector<float>>   the sequences to search
+    * @param gapAllowance  int                     The number of gaps to allow in the search
+    * @param ppmTol        int                     the tolerance in parts per million to accept when searching
+    * @param threads       int                     the number of threads to use. If < 1, one per core is used
+    *
+    * @return vector<vector<string>>   the kmers found for each spectrum, in the same order as spectra
+   */
+   vector<vector<string> > batchFuzzySearch(const vector<vector<float> > & spectra, int gapAllowance, int ppmTol, int threads) const;
 
    /**
     * A search with no gaps allowed
     * 
     * @param sequence       vector<float>   the sequence to search
     * @param ppmTol         int             the tolerance in parts per million to accept when searching
+    * @param stats          SearchStats *   counters to fill in, only when built with MASSDAWG_SEARCH_STATS
     * 
     * @return vector<string>                All kmers that we found in the search
    */
-  vector<string> search(vector<float> sequence, int ppmTol);
+  vector<string> search(const vector<float> & sequence, int ppmTol, SearchStats * stats = nullptr) const;
+
+  /**
+   * Same as search, for a sequence in an array of masses
+   * 
+   * @param sequence       const float *   the sequence to search
+   * @param length         int             the number of masses in sequence
+   * @param ppmTol         int             the tolerance in parts per million to accept when searching
+   * @param stats          SearchStats *   counters to fill in, only when built with MASSDAWG_SEARCH_STATS
+   * 
+   * @return vector<string>                All kmers that we found in the search
+  */
+  vector<string> search(const float * sequence, int length, int ppmTol, SearchStats * stats = nullptr) const;
+
+  /**
+   * Search like fuzzySearch, scoring every path by the masses it matches (or
+   * the sum of their intensities) and returning only the k best kmers. Branches
+   * that can not beat the kth best kmer found so far are not searched
+   *
+   * @param sequence      vector<float>   the sequence to search
+   * @param k             int             the number of kmers to return
+   * @param gapAllowance  int             The number of gaps to allow in the search
+   * @param ppmTol        int             the tolerance in parts per million to accept when searching
+   * @param intensities   vector<float>   the intensity of each mass in sequence. If empty, matched masses are counted
+   * @param stats         SearchStats *   counters to fill in, only when built with MASSDAWG_SEARCH_STATS
+   *
+   * @return vector<ScoredKmer>           up to k kmers, best score first
+   *
+   * @throws invalid_argument    if intensities is not empty or the length of sequence, or has a negative intensity
+  */
+  vector<ScoredKmer> topKSearch(const vector<float> & sequence, int k, int gapAllowance, int ppmTol, 
+      const vector<float> & intensities = vector<float>(), SearchStats * stats = nullptr) const;
+
+  /**
+   * Same as topKSearch, for a sequence in an array of masses
+   *
+   * @param sequence      const float *   the sequence to search
+   * @param intensities   const float *   the intensity of each mass in sequence, or null to count matched masses
+   * @param length        int             the number of masses in sequence
+   * @param k             int             the number of kmers to return
+   * @param gapAllowance  int             The number of gaps to allow in the search
+   * @param ppmTol        int             the tolerance in parts per million to accept when searching
+   * @param stats         SearchStats *   counters to fill in, only when built with MASSDAWG_SEARCH_STATS
+   *
+   * @return vector<ScoredKmer>           up to k kmers, best score first
+   *
+   * @throws invalid_argument    if an intensity is negative
+  */
+  vector<ScoredKmer> topKSearch(const float * sequence, const float * intensities, int length, int k, int gapAllowance, int ppmTol, 
+      SearchStats * stats = nullptr) const;
 
     /**
      * Any remaining unchecked nodes will be checked for merging to 
-     * complete the dawg. 
+     * complete the dawg. More sequences can be inserted afterwards,
+     * and are merged into the finished graph by the next finish
     */
     void finish();
 
+    /**
+     * Walk the graph and measure its size and shape
+     * 
+     * @return MassDawgStats    the node, edge and kmer counts, bytes used, fanout
+     *                          and depth histograms and the merge ratio
+    */
+    MassDawgStats stats() const;
+
 private:
+    // the frozen graph is compiled straight from the nodes
+    friend class FrozenMassDawg;
 
+    // every node of the graph is allocated from (and freed with) the arena
+    MassDawgNodeArena arena;
+    // every kmer (and prefix of a kmer) in the graph, nodes hold ids into it
+    KmerTable kmers;
+    // scratch space for the prefix ids of the kmer being inserted
+    vector<uint32_t> prefixIds;
+    // insertions[id] is the number of times the kmer with that id was inserted and not
+    // removed. Prefixes of kmers have ids as well, but are 0 unless inserted themselves
+    vector<uint32_t> insertions;
     list<UncheckedNode> uncheckedNodes;
-    unordered_map<string, MassDawgNode *> minimizedNodes;
+    MinimizedNodeMap minimizedNodes;
     PreviousSequence previousSequence;
     MassDawgNode * root;    
 
     /**
      * What makes this a graph and not a tree. Combines nodes that share edges and values
      * 
-     * @param downTo    int     the level down to which we need to minimize 
+     * @param downTo    int     unchecked nodes at this depth and deeper are minimized
     */
     void minimize(int downTo);
 
     /**
-     * Recursive search of the graph allowing for gapAllowance missed masses in the
-     * search before returning whatever is found at the level
+     * Add a sequence whose kmer prefix ids are already in prefixIds
      * 
-     * @param sequence      vector<float>  The sequence to use to navigate the graph
-     * @param currentNode   MassDawgNode *  The current node to investigate
-     * @param currentGap    int             The number of gaps we have allowed up until this point
-     * @param gapAllowance  int             The total number of gaps to allow
-     * @param ppmTol        int             the tolerance in parts per million to accept when searching
+     * @param sequence      vector<NodeMasses>  the masses at every charge of each node
+    */
+    void insertInterned(const vector<NodeMasses> & sequence);
+
+    /**
+     * Remove one insertion of a sequence whose kmer prefix ids are in prefixIds.
+     * Prefixes that were never interned have ids past the end of insertions
+     * 
+     * @param sequence      vector<NodeMasses>  the masses at every charge of each node
+     * 
+     * @return bool     True if the sequence was in the graph and was removed, False otherwise
+    */
+    bool removeInterned(const vector<NodeMasses> & sequence);
+
+    // count one more insertion of the kmer whose prefix ids are in prefixIds
+    void countInsertion();
+
+    /**
+     * Copy a finished shard into this finished graph. Shard nodes with the masses of a
+     * node already in the graph are combined with it, the rest are added as new nodes.
+     * The kmer ids of the shard must be ids of this graph's kmers
      * 
-     * @return vector<string>   The kmers associated with the deepest part of the branch investigated
+     * @param shard     const MassDawg &    the graph to merge in
     */
-    vector<string> fuzzySearchRec(vector<float> sequence, MassDawgNode * currentNode, int currentGap, int gapAllowance, int ppmTol);
+    void merge(const MassDawg & shard);
 
     /**	
-     * Checks to see if the new sequences are greater than the old previous sequence	
+     * Checks to see if the new sequence is greater than the old previous sequence	
      * 	
-     * @param singlySequence    vector<float>  the new sequence of singly charged masses	
-     * @param doublySequence    vector<float>  the new sequence of doubly charged masses	
+     * @param sequence      vector<NodeMasses>  the new sequence of masses at every charge	
      * 	
-     * @return bool     True if the new sequences are greater than the prvious, False otherwise	
+     * @return bool     True if the new sequence is greater than the prvious, False otherwise	
     */	
-    bool previousIsLessThan(vector<float> singlySequence, vector<float> doublySequence);
+    bool previousIsLessThan(const vector<NodeMasses> & sequence);
 
     /**
      * Find the longest common prefix of input sequences to a path in the tree. Used for out
      * of order insertions.
      * 
-     * @param singlySequence    vector<float>   the singly sequence we are looking for a prefix of
-     * @param doublySequence    vector<float>   the doubly sequence we are looking for a prefix of
+     * @param sequence      vector<NodeMasses>  the sequence we are looking for a prefix of
      * 
      * @returns LongestCommonPrefix   the class instance holding the longest common prefixe
     */
-    LongestCommonPrefix longestCommonPrefix(vector<float> singlySequence, vector<float> doublySequence);
+    LongestCommonPrefix longestCommonPrefix(const vector<NodeMasses> & sequence);
 };
 #endif
\ No newline at end of file
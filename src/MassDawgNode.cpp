@@ -1,12 +1,42 @@
 #include "MassDawgNode.hpp"
+#include "MassDawgNodeArena.hpp"
 
-MassDawgNode::MassDawgNode (){}
+#include <algorithm>
 
-// init with a string
-MassDawgNode::MassDawgNode (float singlyMass, float doublyMass, string kmer){
+// orders children by their masses, singly charged first
+static bool childLessThan(const MassDawgNode * a, const MassDawgNode * b){
+    return a->masses < b->masses;
+}
+
+// true if the child's masses are below the masses given
+static bool childMassesLessThan(const MassDawgNode * child, const NodeMasses & masses){
+    return child->masses < masses;
+}
+
+// raise the count of the edge to node->children[index]
+static void countChild(MassDawgNode * node, size_t index, uint32_t count){
+    // fills in the 1s of a node that has not stored its counts yet
+    node->childCounts.resize(node->children.size(), 1);
+    node->childCounts[index] += count;
+}
+
+// add an edge to child at index with a count, keeping the counts empty while they are all 1
+static void insertChild(MassDawgNode * node, size_t index, MassDawgNode * child, uint32_t count){
+    if (count != 1 || !node->childCounts.empty()){
+        node->childCounts.resize(node->children.size(), 1);
+        node->childCounts.insert(node->childCounts.begin() + index, count);
+    }
+    node->children.insert(node->children.begin() + index, child);
+}
+
+MassDawgNode::MassDawgNode (){
+    this->masses = NodeMasses();
+}
+
+// init with masses and a kmer id
+MassDawgNode::MassDawgNode (const NodeMasses & masses, uint32_t kmer){
         this->kmers.push_back(kmer);
-        this->singlyMass = singlyMass;
-        this->doublyMass = doublyMass;
+        this->masses = masses;
     }
 
 // it is assumed all nodes are deleted INDEPENDENTLY of eachother, 
@@ -25,30 +55,86 @@ MassDawgNode::~MassDawgNode(){
 }
 
 /**
- * Add a kmer to the set of kmers. No duplicates will be made
+ * Add a kmer to the set of kmers. No duplicates will be made, a kmer
+ * already in the set has its count raised instead
  * 
- * @param kmer  string      kmer to add to node
+ * @param kmer  uint32_t    id of the kmer to add to node
+ * @param count uint32_t    the number of insertions to count the kmer for
 */
-void MassDawgNode::addKmer (string kmer){
+void MassDawgNode::addKmer (uint32_t kmer, uint32_t count){
     // check to see if this kmer exists in the set. If not, add it
     for (int i = 0; i < (int)this->kmers.size(); i++){
-        if (this->kmers[i].compare(kmer) == 0) return;
+        if (this->kmers[i] == kmer){
+            // fills in the 1s of a node that has not stored its counts yet
+            this->kmerCounts.resize(this->kmers.size(), 1);
+            this->kmerCounts[i] += count;
+            return;
+        }
+    }
+
+    if (count != 1 || !this->kmerCounts.empty()){
+        this->kmerCounts.resize(this->kmers.size(), 1);
+        this->kmerCounts.push_back(count);
     }
     this->kmers.push_back(kmer);
 }
 
+/**
+ * Take one insertion off the count of a kmer, dropping the kmer when
+ * no insertions are left
+ * 
+ * @param kmer  uint32_t    id of the kmer to remove
+ * 
+ * @return bool     True if the kmer was in the set, False otherwise
+*/
+bool MassDawgNode::removeKmer (uint32_t kmer){
+    for (int i = 0; i < (int)this->kmers.size(); i++){
+        if (this->kmers[i] != kmer) continue;
+
+        if (this->kmerCountAt(i) > 1){
+            this->kmerCounts[i] --;
+            return true;
+        }
+
+        // erased in place so the other kmers keep the order searches return them in
+        this->kmers.erase(this->kmers.begin() + i);
+        if (!this->kmerCounts.empty()) this->kmerCounts.erase(this->kmerCounts.begin() + i);
+        return true;
+    }
+    return false;
+}
+
+/**
+ * Get the number of insertions that reached this node with a kmer
+ * 
+ * @param kmer  uint32_t    id of the kmer
+ * 
+ * @return uint32_t     the count, 0 if the kmer is not in the set
+*/
+uint32_t MassDawgNode::kmerCount (uint32_t kmer) const {
+    for (int i = 0; i < (int)this->kmers.size(); i++){
+        if (this->kmers[i] == kmer) return this->kmerCountAt(i);
+    }
+    return 0;
+}
+
 /**
  * Add a child node to the node called on by creating a connecting edge
  * 
- * @param singlyMass    float  singly charged mass to connect nodes
- * @param doublyMass    float  doubly charged mass to connect nodes
- * @param kmer          string  the string to associate with the new kmer
+ * @param masses        NodeMasses  the masses at each charge to connect nodes
+ * @param kmer          uint32_t    the id of the kmer to associate with the new child
+ * @param arena         MassDawgNodeArena *     where to allocate the child from. If null, the child is made with new
  * 
  * @return Edge *       edge connecting the parent to the new child
 */
-MassDawgNode * MassDawgNode::addChild(float singlyMass, float doublyMass, string kmer){
-    MassDawgNode * newChild = new MassDawgNode(singlyMass, doublyMass, kmer);
-    this->children.push_back(newChild);
+MassDawgNode * MassDawgNode::addChild(const NodeMasses & masses, uint32_t kmer, MassDawgNodeArena * arena){
+    MassDawgNode * newChild = arena == nullptr 
+        ? new MassDawgNode(masses, kmer) 
+        : arena->allocate(masses, kmer);
+
+    // keep the children sorted, with the count of each edge at the same index
+    vector<MassDawgNode *>::iterator it = upper_bound(this->children.begin(), this->children.end(), newChild, childLessThan);
+    insertChild(this, it - this->children.begin(), newChild, 1);
 
     return newChild;
 }
@@ -57,47 +143,143 @@ MassDawgNode * MassDawgNode::addChild(float singlyMass, float doublyMass, string
  * Add a child. The child node exists, and we are merely adding the 
  * pointer of the new child to the nodes internal list. The node's values
  * is checked against all nodes in the list to ensure that a duplicate is not
- * created
+ * created, the count of the child already there is raised instead
  * 
  * @param newChild      MassDawgNode *  pointer to the new node to add
+ * @param count         uint32_t        the number of insertions to count the edge for
+*/
+void MassDawgNode::addChildByPointer(MassDawgNode * newChild, uint32_t count){
+    // newChild itself would be found here as well
+    vector<MassDawgNode *>::iterator it = lower_bound(this->children.begin(), this->children.end(), newChild, childLessThan);
+    size_t index = it - this->children.begin();
+
+    if (it != this->children.end() && (*it)->masses == newChild->masses){
+        countChild(this, index, count);
+        return;
+    }
+
+    insertChild(this, index, newChild, count);
+}
+
+/**
+ * Add an existing node as a child unless that exact node is already one,
+ * in which case the count of its edge is raised. Unlike addChildByPointer,
+ * a different child with the same masses does not stop the edge from being added
+ * 
+ * @param newChild      MassDawgNode *  pointer to the node to add
+ * @param count         uint32_t        the number of insertions to count the edge for
+*/
+void MassDawgNode::linkChild(MassDawgNode * newChild, uint32_t count){
+    // sorted insertions almost always take the edge to the last child added
+    if (!this->children.empty() && this->children.back() == newChild){
+        countChild(this, this->children.size() - 1, count);
+        return;
+    }
+
+    // only children with exactly the same masses can be the same node
+    auto range = equal_range(this->children.begin(), this->children.end(), newChild, childLessThan);
+    auto found = find(range.first, range.second, newChild);
+    if (found != range.second){
+        countChild(this, found - this->children.begin(), count);
+        return;
+    }
+
+    insertChild(this, range.second - this->children.begin(), newChild, count);
+}
+
+/**
+ * Take one insertion off the count of the edge to a child, dropping the
+ * edge when no insertions are left
+ * 
+ * @param child     MassDawgNode *  the child the edge points to
+ * 
+ * @return bool     True if the edge was found, False otherwise
+*/
+bool MassDawgNode::unlinkChild(MassDawgNode * child){
+    auto range = equal_range(this->children.begin(), this->children.end(), child, childLessThan);
+    auto found = find(range.first, range.second, child);
+    if (found == range.second) return false;
+
+    size_t index = found - this->children.begin();
+    if (this->childCountAt((int)index) > 1){
+        this->childCounts[index] --;
+        return true;
+    }
+
+    this->children.erase(found);
+    if (!this->childCounts.empty()) this->childCounts.erase(this->childCounts.begin() + index);
+    return true;
+}
+
+/**
+ * Binary search the children for one with exactly the masses given
+ * 
+ * @param masses    NodeMasses  the masses at each charge to look for
+ * 
+ * @return MassDawgNode *   the matching child, or nullptr if there is none
+*/
+MassDawgNode * MassDawgNode::findChild(const NodeMasses & masses) const {
+    vector<MassDawgNode *>::const_iterator it = lower_bound(
+        this->children.begin(), 
+        this->children.end(), 
+        masses, 
+        childMassesLessThan
+    );
+
+    if (it != this->children.end() && (*it)->masses == masses) return *it;
+    return nullptr;
+}
+
+/**
+ * Point the edge to oldChild at newChild instead. Both must have the same masses
+ * 
+ * @param oldChild      MassDawgNode *  the child currently pointed to
+ * @param newChild      MassDawgNode *  the child to point to
 */
-void MassDawgNode::addChildByPointer(MassDawgNode * newChild){
-    float delta = .001;
+void MassDawgNode::replaceChild(MassDawgNode * oldChild, MassDawgNode * newChild){
+    // children with the same masses as oldChild start here
+    vector<MassDawgNode *>::iterator it = lower_bound(
+        this->children.begin(), 
+        this->children.end(), 
+        oldChild, 
+        childLessThan
+    );
 
-    for (MassDawgNode * child: this->children){
-        if (child == newChild || 
-        (abs(child->singlyMass - newChild->singlyMass) < delta 
-        && abs(child->doublyMass - newChild->doublyMass) < delta)){
+    for (; it != this->children.end() && !childLessThan(oldChild, *it); it++){
+        if (*it == oldChild){
+            *it = newChild;
             return;
         }
     }
-    this->children.push_back(newChild);
 }
 
 /**
- * Turn the node's value into a large string in order to make 
- * it hashable
+ * Pack the node's masses into one integer key, used to find nodes
+ * with the same masses
  * 
- * @return string   the hashable string
+ * @return uint64_t     the key of the node
 */
-string MassDawgNode::hash(){
-    return to_string(this->singlyMass) + '_' + to_string(this->doublyMass);
+uint64_t MassDawgNode::hash() const {
+    return this->masses.hash();
 }
 
 /**
 * Recursively show this node and all subsequent nodes and edges
 * 
-* @param spaces int     the number of spaces to prepend before printing
+* @param spaces int                 the number of spaces to prepend before printing
+* @param kmers  const KmerTable &   the table to look the kmer ids up in
 */
-void MassDawgNode::show(int spaces){
+void MassDawgNode::show(int spaces, const KmerTable & kmers){
     for (int i = 0; i < spaces; i++) cout << " ";
 
     // print kmers
     cout << "|---> kmers: {";
-    if (this->kmers.size() > 0) cout << this->kmers[0];
-    for (int i = 1; i < (int)this->kmers.size(); i ++) cout << ", " + this->kmers[i];
-    cout << "} \t masses: " + to_string(this->singlyMass) + ", " + to_string(this->doublyMass) + "\n";
+    if (this->kmers.size() > 0) cout << kmers.get(this->kmers[0]);
+    for (int i = 1; i < (int)this->kmers.size(); i ++) cout << ", " + kmers.get(this->kmers[i]);
+    cout << "} \t masses: " + to_string(fixedMassToDa(this->masses[0]));
+    for (int z = 1; z < NodeMasses::charges; z++) cout << ", " + to_string(fixedMassToDa(this->masses[z]));
+    cout << "\n";
 
     // show each child
-    for (int i = 0; i < (int)this->children.size(); i++) this->children[i]->show(spaces+2);
+    for (int i = 0; i < (int)this->children.size(); i++) this->children[i]->show(spaces+2, kmers);
 }
\ No newline at end of file
@@ -5,69 +5,171 @@
 #include <string>
 #include <iostream>
 #include <cmath>
+#include <cstdint>
+
+#include "KmerTable.hpp"
+#include "utils.hpp"
 
 using namespace std;
 
+class MassDawgNodeArena;
+
 class MassDawgNode{
 public:
-    // kmer values associated with incoming mass values
-    vector<string> kmers;
-    // outgoing mass edges
+    // ids (in the graph's KmerTable) of the kmers associated with incoming mass values
+    vector<uint32_t> kmers;
+    // kmerCounts[i] is the number of insertions that reached this node with kmers[i].
+    // Empty while every count is 1, as it is for most nodes, so they allocate nothing for it
+    vector<uint32_t> kmerCounts;
+    // outgoing mass edges, sorted by masses
     vector<MassDawgNode *> children;
-    // the sinlgy and doubly mass of this node
-    float singlyMass;
-    float doublyMass;
+    // childCounts[i] is the number of insertions that took the edge to children[i].
+    // Empty while every count is 1, like kmerCounts
+    vector<uint32_t> childCounts;
+    // the mass of this node at each charge, 1 to MASSDAWG_CHARGES
+    NodeMasses masses;
 
     // empty constructor
     MassDawgNode ();
 
-    // init with masses and a string
-    MassDawgNode (float singlyMass, float doublyMass, string kmer);
+    // init with masses and a kmer id
+    MassDawgNode (const NodeMasses & masses, uint32_t kmer);
 
     ~MassDawgNode();
 
+    // the number of insertions that reached this node with kmers[i]
+    uint32_t kmerCountAt(int i) const { return this->kmerCounts.empty() ? 1 : this->kmerCounts[i]; }
+
+    // the number of insertions that took the edge to children[i]
+    uint32_t childCountAt(int i) const { return this->childCounts.empty() ? 1 : this->childCounts[i]; }
+
+    /**
+     * Add a kmer to the set of kmers. No duplicates will be made, a kmer
+     * already in the set has its count raised instead
+     * 
+     * @param kmer  uint32_t    id of the kmer to add to node
+     * @param count uint32_t    the number of insertions to count the kmer for
+    */
+    void addKmer (uint32_t kmer, uint32_t count = 1);
+
     /**
-     * Add a kmer to the set of kmers. No duplicates will be made
+     * Take one insertion off the count of a kmer, dropping the kmer when
+     * no insertions are left
      * 
-     * @param kmer  string      kmer to add to node
+     * @param kmer  uint32_t    id of the kmer to remove
+     * 
+     * @return bool     True if the kmer was in the set, False otherwise
     */
-    void addKmer (string kmer);
+    bool removeKmer (uint32_t kmer);
+
+    /**
+     * Get the number of insertions that reached this node with a kmer
+     * 
+     * @param kmer  uint32_t    id of the kmer
+     * 
+     * @return uint32_t     the count, 0 if the kmer is not in the set
+    */
+    uint32_t kmerCount (uint32_t kmer) const;
 
     /**
      * Add a child node to the node called on by creating a connecting edge
      * 
-     * @param singlyMass    float  singly charged mass to connect nodes
-     * @param doublyMass    float  doubly charged mass to connect nodes
-     * @param kmer          string  the string to associate with the new kmer
+     * @param masses        NodeMasses  the masses at each charge to connect nodes
+     * @param kmer          uint32_t    the id of the kmer to associate with the new child
+     * @param arena         MassDawgNodeArena *     where to allocate the child from. If null, the child is made with new
      * 
      * @return MassDawgNode *   the new child added
     */
-    MassDawgNode * addChild(float singlyMass, float doublyMass, string kmer);
+    MassDawgNode * addChild(const NodeMasses & masses, uint32_t kmer, MassDawgNodeArena * arena = nullptr);
 
     /**
      * Add a child. The child node exists, and we are merely adding the 
      * pointer of the new child to the nodes internal list. The node's values
      * is checked against all nodes in the list to ensure that a duplicate is not
-     * created
+     * created, the count of the child already there is raised instead
      * 
      * @param newChild      MassDawgNode *  pointer to the new node to add
+     * @param count         uint32_t        the number of insertions to count the edge for
+    */
+    void addChildByPointer(MassDawgNode * newChild, uint32_t count = 1);
+
+    /**
+     * Add an existing node as a child unless that exact node is already one,
+     * in which case the count of its edge is raised. Unlike addChildByPointer,
+     * a different child with the same masses does not stop the edge from being added
+     * 
+     * @param newChild      MassDawgNode *  pointer to the node to add
+     * @param count         uint32_t        the number of insertions to count the edge for
+    */
+    void linkChild(MassDawgNode * newChild, uint32_t count = 1);
+
+    /**
+     * Take one insertion off the count of the edge to a child, dropping the
+     * edge when no insertions are left
+     * 
+     * @param child     MassDawgNode *  the child the edge points to
+     * 
+     * @return bool     True if the edge was found, False otherwise
     */
-    void addChildByPointer(MassDawgNode * newChild);
+    bool unlinkChild(MassDawgNode * child);
 
+    /**
+     * Binary search the children for one with exactly the masses given
+     * 
+     * @param masses    NodeMasses  the masses at each charge to look for
+     * 
+     * @return MassDawgNode *   the matching child, or nullptr if there is none
+    */
+    MassDawgNode * findChild(const NodeMasses & masses) const;
 
     /**
-     * Turn the node's value into a large string in order to make 
-     * it hashable
+     * Point the edge to oldChild at newChild instead. Both must have the same masses
      * 
-     * @return string   the hashable string
+     * @param oldChild      MassDawgNode *  the child currently pointed to
+     * @param newChild      MassDawgNode *  the child to point to
     */
-   string hash();
+    void replaceChild(MassDawgNode * oldChild, MassDawgNode * newChild);
+
+
+    /**
+     * Pack the node's masses into one integer key, used to find nodes
+     * with the same masses
+     * 
+     * @return uint64_t     the key of the node
+    */
+   uint64_t hash() const;
 
    /**
     * Recursively show this node and all subsequent nodes and edges
     * 
-    * @param spaces int     the number of spaces to prepend before printing
+    * @param spaces int                 the number of spaces to prepend before printing
+    * @param kmers  const KmerTable &   the table to look the kmer ids up in
    */
-    void show(int spaces);
+    void show(int spaces, const KmerTable & kmers);
+};
+
+/**
+ * Read only view of a graph of MassDawgNodes used by the routines in
+ * GraphSearch.hpp
+*/
+class MassDawgNodeView {
+public:
+    typedef const MassDawgNode * Node;
+
+    MassDawgNodeView(const MassDawgNode * root, const KmerTable * kmers) : rootNode(root), kmerTable(kmers) {}
+
+    Node root() const { return this->rootNode; }
+    int childCount(Node node) const { return (int)node->children.size(); }
+    Node child(Node node, int i) const { return node->children[i]; }
+    FixedMass mass(Node node, int charge) const { return node->masses[charge - 1]; }
+    MassWindows windows(Node node, int ppmTol) const { return massWindows(node->masses, ppmTol); }
+    void appendKmers(Node node, vector<string> & out) const {
+        for (uint32_t kmer: node->kmers) out.push_back(this->kmerTable->get(kmer));
+    }
+    int maxDepth() const { return (int)this->kmerTable->maxLength(); }
+
+private:
+    const MassDawgNode * rootNode;
+    const KmerTable * kmerTable;
 };
 #endif
\ No newline at end of file
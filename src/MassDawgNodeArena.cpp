@@ -0,0 +1,92 @@
+#include <new>
+
+#include "MassDawgNodeArena.hpp"
+
+/**
+ * @param slabSize  int     the number of nodes to allocate at a time
+*/
+MassDawgNodeArena::MassDawgNodeArena(int slabSize){
+    this->slabSize = slabSize > 0 ? slabSize : 1;
+    // start as if the last slab is full so the first allocation makes one
+    this->usedInSlab = this->slabSize;
+}
+
+// nodes on the free list are still constructed (they keep their storage
+// for reuse), so every constructed slot is destroyed the same way
+MassDawgNodeArena::~MassDawgNodeArena(){
+    for (int s = 0; s < (int)this->slabs.size(); s++){
+        int constructed = s == (int)this->slabs.size() - 1 ? this->usedInSlab : this->slabSize;
+        for (int i = 0; i < constructed; i++) this->slabs[s][i].~MassDawgNode();
+
+        ::operator delete(this->slabs[s]);
+    }
+}
+
+/**
+ * Get an empty node with no masses, kmers or children
+ *
+ * @return MassDawgNode *   the new node
+*/
+MassDawgNode * MassDawgNodeArena::allocate(){
+    // reuse a released node if we have one
+    if (!this->freeList.empty()){
+        MassDawgNode * node = this->freeList.back();
+        this->freeList.pop_back();
+        return node;
+    }
+
+    // otherwise bump into the last slab, making a new one if it is full
+    if (this->usedInSlab == this->slabSize){
+        this->slabs.push_back(static_cast<MassDawgNode *>(::operator new(sizeof(MassDawgNode) * this->slabSize)));
+        this->usedInSlab = 0;
+    }
+
+    MassDawgNode * node = new (this->slabs.back() + this->usedInSlab) MassDawgNode();
+    this->usedInSlab ++;
+
+    return node;
+}
+
+/**
+ * Get a node with masses and a kmer
+ *
+ * @param masses    NodeMasses  the masses of the node at each charge
+ * @param kmer      uint32_t    the id of the kmer to associate with the node
+ *
+ * @return MassDawgNode *   the new node
+*/
+MassDawgNode * MassDawgNodeArena::allocate(const NodeMasses & masses, uint32_t kmer){
+    MassDawgNode * node = this->allocate();
+    node->masses = masses;
+    node->kmers.push_back(kmer);
+
+    return node;
+}
+
+/**
+ * Give a node back to the arena so it can be reused. The node must not
+ * be used after this
+ *
+ * @param node      MassDawgNode *  the node to release
+*/
+void MassDawgNodeArena::release(MassDawgNode * node){
+    // clear but keep the capacity of the vectors for the next user
+    node->kmers.clear();
+    node->kmerCounts.clear();
+    node->children.clear();
+    node->childCounts.clear();
+    node->masses = NodeMasses();
+
+    this->freeList.push_back(node);
+}
+
+// the number of nodes handed out and not released
+int MassDawgNodeArena::liveNodes() const {
+    int constructed = this->slabs.empty() ? 0 : ((int)this->slabs.size() - 1) * this->slabSize + this->usedInSlab;
+    return constructed - (int)this->freeList.size();
+}
+
+// bytes of the slabs, including released nodes but not the vectors the nodes own
+size_t MassDawgNodeArena::memoryUsage() const {
+    return this->slabs.size() * this->slabSize * sizeof(MassDawgNode);
+}
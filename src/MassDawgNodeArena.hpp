@@ -0,0 +1,69 @@
+#ifndef MASSDAWGNODEARENA_H
+#define MASSDAWGNODEARENA_H
+
+#include <vector>
+#include <string>
+
+#include "MassDawgNode.hpp"
+
+using namespace std;
+
+/**
+ * Slab allocator for the nodes of a MassDawg. Nodes are constructed in large
+ * slabs instead of one heap allocation each. Nodes released after merging are
+ * kept on a free list (with their kmer and children storage) and handed out
+ * again by the next allocation. Destroying the arena frees every node it made.
+*/
+class MassDawgNodeArena {
+public:
+    /**
+     * @param slabSize  int     the number of nodes to allocate at a time
+    */
+    MassDawgNodeArena(int slabSize = 1024);
+
+    // destroys every node allocated by the arena
+    ~MassDawgNodeArena();
+
+    // nodes are owned by the arena, so it can not be copied
+    MassDawgNodeArena(const MassDawgNodeArena &) = delete;
+    MassDawgNodeArena & operator=(const MassDawgNodeArena &) = delete;
+
+    /**
+     * Get an empty node with no masses, kmers or children
+     *
+     * @return MassDawgNode *   the new node
+    */
+    MassDawgNode * allocate();
+
+    /**
+     * Get a node with masses and a kmer
+     *
+     * @param masses    NodeMasses  the masses of the node at each charge
+     * @param kmer      uint32_t    the id of the kmer to associate with the node
+     *
+     * @return MassDawgNode *   the new node
+    */
+    MassDawgNode * allocate(const NodeMasses & masses, uint32_t kmer);
+
+    /**
+     * Give a node back to the arena so it can be reused. The node must not
+     * be used after this
+     *
+     * @param node      MassDawgNode *  the node to release
+    */
+    void release(MassDawgNode * node);
+
+    // the number of nodes handed out and not released
+    int liveNodes() const;
+
+    // bytes of the slabs, including released nodes but not the vectors the nodes own
+    size_t memoryUsage() const;
+
+private:
+    vector<MassDawgNode *> slabs;
+    vector<MassDawgNode *> freeList;
+    int slabSize;
+    // nodes constructed in the last slab
+    int usedInSlab;
+};
+#endif
@@ -0,0 +1,102 @@
+#include "MinimizedNodeMap.hpp"
+
+MinimizedNodeMap::MinimizedNodeMap(){
+    this->entries = vector<Entry>(1024, Entry {0, nullptr});
+    this->count = 0;
+}
+
+/**
+ * Find the node registered with some masses
+ *
+ * @param masses    NodeMasses  the masses of the node
+ *
+ * @return MassDawgNode *   the node, or nullptr if no node has the masses
+*/
+MassDawgNode * MinimizedNodeMap::find(const NodeMasses & masses) const {
+    return this->entries[this->findEntry(masses)].node;
+}
+
+/**
+ * Register a node by its masses. If a node already has the masses, it is replaced
+ *
+ * @param node      MassDawgNode *  the node to register
+*/
+void MinimizedNodeMap::insert(MassDawgNode * node){
+    Entry & entry = this->entries[this->findEntry(node->masses)];
+    if (entry.node == nullptr) this->count ++;
+
+    entry.key = node->hash();
+    entry.node = node;
+
+    // keep the table at most half full so probes stay short
+    if ((size_t)this->count * 2 > this->entries.size()) this->grow();
+}
+
+/**
+ * Unregister a node. Nothing happens if another node (or no node) is
+ * registered with its masses
+ *
+ * @param node      MassDawgNode *  the node to unregister
+*/
+void MinimizedNodeMap::remove(MassDawgNode * node){
+    uint32_t hole = this->findEntry(node->masses);
+    if (this->entries[hole].node != node) return;
+
+    this->entries[hole] = Entry {0, nullptr};
+    this->count --;
+
+    // shift back the entries after the hole that probed past it, or
+    // finding them would stop at the hole
+    uint32_t mask = (uint32_t)this->entries.size() - 1;
+    for (uint32_t index = (hole + 1) & mask; this->entries[index].node != nullptr; index = (index + 1) & mask){
+        uint32_t home = (uint32_t)mixKey(this->entries[index].key) & mask;
+
+        // an entry whose home is after the hole is already as close to it as it can be
+        if (((index - home) & mask) < ((index - hole) & mask)) continue;
+
+        this->entries[hole] = this->entries[index];
+        this->entries[index] = Entry {0, nullptr};
+        hole = index;
+    }
+}
+
+// bytes used by the table
+size_t MinimizedNodeMap::memoryUsage() const {
+    return this->entries.capacity() * sizeof(Entry);
+}
+
+/**
+ * Find the entry holding the masses, or the empty entry where they would go
+ *
+ * @param masses    NodeMasses  the masses to look for
+ *
+ * @return uint32_t     the index of the entry
+*/
+uint32_t MinimizedNodeMap::findEntry(const NodeMasses & masses) const {
+    uint64_t key = masses.hash();
+    uint32_t mask = (uint32_t)this->entries.size() - 1;
+    uint32_t index = (uint32_t)mixKey(key) & mask;
+
+    // the key is checked first so most other nodes are passed without reading them
+    while (this->entries[index].node != nullptr 
+    && (this->entries[index].key != key || this->entries[index].node->masses != masses)){
+        index = (index + 1) & mask;
+    }
+    return index;
+}
+
+// double the number of entries and reinsert every node
+void MinimizedNodeMap::grow(){
+    vector<Entry> old;
+    old.swap(this->entries);
+    this->entries = vector<Entry>(old.size() * 2, Entry {0, nullptr});
+
+    uint32_t mask = (uint32_t)this->entries.size() - 1;
+    for (const Entry & entry: old){
+        if (entry.node == nullptr) continue;
+
+        uint32_t index = (uint32_t)mixKey(entry.key) & mask;
+        while (this->entries[index].node != nullptr) index = (index + 1) & mask;
+        this->entries[index] = entry;
+    }
+}
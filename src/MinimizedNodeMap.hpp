@@ -0,0 +1,76 @@
+#ifndef MINIMIZEDNODEMAP_H
+#define MINIMIZEDNODEMAP_H
+
+#include <vector>
+#include <cstdint>
+
+#include "MassDawgNode.hpp"
+
+using namespace std;
+
+/**
+ * Registry of minimized nodes keyed by their masses. An open addressing hash
+ * table with linear probing that stores the 64 bit MassDawgNode::hash() keys and
+ * node pointers side by side, so lookups never build or hash strings. Keys only
+ * hold every mass up to 2 charges, so the masses of a node with the same key are
+ * compared before it is returned.
+*/
+class MinimizedNodeMap {
+public:
+    MinimizedNodeMap();
+
+    ~MinimizedNodeMap(){}
+
+    /**
+     * Find the node registered with some masses
+     *
+     * @param masses    NodeMasses  the masses of the node
+     *
+     * @return MassDawgNode *   the node, or nullptr if no node has the masses
+    */
+    MassDawgNode * find(const NodeMasses & masses) const;
+
+    /**
+     * Register a node by its masses. If a node already has the masses, it is replaced
+     *
+     * @param node      MassDawgNode *  the node to register
+    */
+    void insert(MassDawgNode * node);
+
+    /**
+     * Unregister a node. Nothing happens if another node (or no node) is
+     * registered with its masses
+     *
+     * @param node      MassDawgNode *  the node to unregister
+    */
+    void remove(MassDawgNode * node);
+
+    // the number of registered nodes
+    int size() const { return this->count; }
+
+    // bytes used by the table
+    size_t memoryUsage() const;
+
+private:
+    struct Entry {
+        uint64_t key;
+        MassDawgNode * node;
+    };
+
+    // sized to a power of 2, empty entries have a null node
+    vector<Entry> entries;
+    int count;
+
+    /**
+     * Find the entry holding the masses, or the empty entry where they would go
+     *
+     * @param masses    NodeMasses  the masses to look for
+     *
+     * @return uint32_t     the index of the entry
+    */
+    uint32_t findEntry(const NodeMasses & masses) const;
+
+    // double the number of entries and reinsert every node
+    void grow();
+};
+#endif
@@ -0,0 +1,26 @@
+#ifndef SCOREDKMER_H
+#define SCOREDKMER_H
+
+#include <string>
+
+using namespace std;
+
+/**
+ * A kmer returned by a top k search with the score of the path that found it
+*/
+class ScoredKmer {
+public:
+    string kmer;
+    // the peaks matched on the path, or the sum of their intensities
+    float score;
+
+    ScoredKmer(): score(0) {}
+    ScoredKmer(const string & kmer, float score): kmer(kmer), score(score) {}
+
+    // best score first, ties by kmer so results are in a fixed order
+    bool operator<(const ScoredKmer & other) const {
+        if (this->score != other.score) return this->score > other.score;
+        return this->kmer < other.kmer;
+    }
+};
+#endif
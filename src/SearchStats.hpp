@@ -0,0 +1,62 @@
+#ifndef SEARCHSTATS_H
+#define SEARCHSTATS_H
+
+using namespace std;
+
+/**
+ * What a single search did, filled in by search and fuzzySearch when they are
+ * given one. Counting is compiled in only when MASSDAWG_SEARCH_STATS is defined
+ * (make CFLAGS="... -DMASSDAWG_SEARCH_STATS"), otherwise the counters are never
+ * touched and the searches run exactly as they would without them.
+ *
+ * Searches add to the counters, so reset between queries to see each one alone.
+*/
+class SearchStats {
+public:
+    // nodes whose masses were compared to the spectrum
+    long nodesVisited;
+    // tolerance windows looked up in the spectrum
+    long toleranceChecks;
+    // nodes that matched no mass and were searched past by using a gap
+    long gapBranches;
+    // the deepest node visited, 1 for the children of the root
+    int maxDepth;
+    // kmers added to the results
+    long resultsEmitted;
+    // nodes a memoized search reached again in the same state and took the results of
+    long memoHits;
+
+    SearchStats(){ this->reset(); }
+
+    ~SearchStats(){}
+
+    // zero every counter
+    void reset(){
+        this->nodesVisited = 0;
+        this->toleranceChecks = 0;
+        this->gapBranches = 0;
+        this->maxDepth = 0;
+        this->resultsEmitted = 0;
+        this->memoHits = 0;
+    }
+
+    // true if the searches were compiled to fill in the counters
+    static bool enabled(){
+#ifdef MASSDAWG_SEARCH_STATS
+        return true;
+#else
+        return false;
+#endif
+    }
+};
+
+// add to or raise a counter of a SearchStats pointer that may be null
+#ifdef MASSDAWG_SEARCH_STATS
+#define SEARCH_STATS_ADD(stats, counter, amount)    do { if (stats) (stats)->counter += (amount); } while (0)
+#define SEARCH_STATS_MAX(stats, counter, value)     do { if ((stats) && (value) > (stats)->counter) (stats)->counter = (value); } while (0)
+#else
+#define SEARCH_STATS_ADD(stats, counter, amount)    do {} while (0)
+#define SEARCH_STATS_MAX(stats, counter, value)     do {} while (0)
+#endif
+
+#endif
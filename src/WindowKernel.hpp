@@ -0,0 +1,230 @@
+#ifndef WINDOWKERNEL_H
+#define WINDOWKERNEL_H
+
+#include <algorithm>
+
+#include "utils.hpp"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && defined(__SSE2__)
+#define WINDOW_KERNEL_X86
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+// sorted masses up to this many are scanned with vector compares, longer ones are binary searched
+#define WINDOW_KERNEL_MAX_SCAN      256
+
+/**
+ * Find the masses of a sorted array inside a tolerance window, or below a bound.
+ * The masses of a spectrum are few enough that comparing 4 or 8 of them per
+ * instruction against both ends of the window, and stopping at the first block
+ * that is not all inside or below it, beats the unpredictable branches of two
+ * binary searches. The masses in a window of a sorted array are a run of indices,
+ * so the matches come back as the range of that run.
+ *
+ * findWindow and countBelow pick AVX2 when the CPU has it, SSE2 on any other x86
+ * and plain C++ everywhere else. Masses are 32 bit integers, so the compares are
+ * exact and the result is the same on every path.
+*/
+
+// the masses of a sorted array in a window are sorted[start, end)
+struct WindowMatches {
+    int start;
+    int end;
+};
+
+/**
+ * Count the masses below bound one at a time
+ *
+ * @param sorted    const FixedMass *   masses sorted smallest to largest
+ * @param length    int                 the number of masses
+ * @param bound     FixedMass           the bound to count below
+ *
+ * @return int      the number of masses < bound
+*/
+inline int countBelowScalar(const FixedMass * sorted, int length, FixedMass bound){
+    int count = 0;
+    while (count < length && sorted[count] < bound) count ++;
+    return count;
+}
+
+/**
+ * Find the masses in a window one at a time
+ *
+ * @param sorted        const FixedMass *   masses sorted smallest to largest
+ * @param length        int                 the number of masses
+ * @param lowerBound    FixedMass           the smallest mass in the window
+ * @param upperBound    FixedMass           the largest mass in the window, at least lowerBound
+ *
+ * @return WindowMatches    the range of masses in [lowerBound, upperBound]
+*/
+inline WindowMatches findWindowScalar(const FixedMass * sorted, int length, FixedMass lowerBound, FixedMass upperBound){
+    WindowMatches matches;
+    matches.start = countBelowScalar(sorted, length, lowerBound);
+    matches.end = matches.start;
+    while (matches.end < length && sorted[matches.end] <= upperBound) matches.end ++;
+    return matches;
+}
+
+#ifdef WINDOW_KERNEL_X86
+/**
+ * Find the masses in a window 4 at a time with SSE2
+ *
+ * @param sorted        const FixedMass *   masses sorted smallest to largest
+ * @param length        int                 the number of masses
+ * @param lowerBound    FixedMass           the smallest mass in the window
+ * @param upperBound    FixedMass           the largest mass in the window, at least lowerBound
+ *
+ * @return WindowMatches    the range of masses in [lowerBound, upperBound]
+*/
+inline WindowMatches findWindowSse2(const FixedMass * sorted, int length, FixedMass lowerBound, FixedMass upperBound){
+    __m128i lowers = _mm_set1_epi32(lowerBound);
+    __m128i uppers = _mm_set1_epi32(upperBound);
+
+    int below = 0;
+    int i = 0;
+    for (; i + 4 <= length; i += 4){
+        __m128i block = _mm_loadu_si128((const __m128i *)(sorted + i));
+        below += __builtin_popcount(_mm_movemask_ps(_mm_castsi128_ps(_mm_cmplt_epi32(block, lowers))));
+        int notAbove = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(block, uppers))) ^ 0xf;
+
+        // the masses are sorted, so nothing after the first block not all at or
+        // below the window is in it, or below it
+        if (notAbove != 0xf) return WindowMatches {below, i + __builtin_popcount(notAbove)};
+    }
+
+    WindowMatches rest = findWindowScalar(sorted + i, length - i, lowerBound, upperBound);
+    return WindowMatches {below + rest.start, i + rest.end};
+}
+
+/**
+ * Find the masses in a window 8 at a time with AVX2. Only called when the CPU has AVX2
+ *
+ * @param sorted        const FixedMass *   masses sorted smallest to largest
+ * @param length        int                 the number of masses
+ * @param lowerBound    FixedMass           the smallest mass in the window
+ * @param upperBound    FixedMass           the largest mass in the window, at least lowerBound
+ *
+ * @return WindowMatches    the range of masses in [lowerBound, upperBound]
+*/
+__attribute__((target("avx2")))
+inline WindowMatches findWindowAvx2(const FixedMass * sorted, int length, FixedMass lowerBound, FixedMass upperBound){
+    __m256i lowers = _mm256_set1_epi32(lowerBound);
+    __m256i uppers = _mm256_set1_epi32(upperBound);
+
+    int below = 0;
+    int i = 0;
+    for (; i + 8 <= length; i += 8){
+        __m256i block = _mm256_loadu_si256((const __m256i *)(sorted + i));
+        below += __builtin_popcount(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(lowers, block))));
+        int notAbove = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(block, uppers))) ^ 0xff;
+
+        // the masses are sorted, so nothing after the first block not all at or
+        // below the window is in it, or below it
+        if (notAbove != 0xff) return WindowMatches {below, i + __builtin_popcount(notAbove)};
+    }
+
+    WindowMatches rest = findWindowScalar(sorted + i, length - i, lowerBound, upperBound);
+    return WindowMatches {below + rest.start, i + rest.end};
+}
+
+/**
+ * Count the masses below bound 4 at a time with SSE2
+ *
+ * @param sorted    const FixedMass *   masses sorted smallest to largest
+ * @param length    int                 the number of masses
+ * @param bound     FixedMass           the bound to count below
+ *
+ * @return int      the number of masses < bound
+*/
+inline int countBelowSse2(const FixedMass * sorted, int length, FixedMass bound){
+    __m128i bounds = _mm_set1_epi32(bound);
+
+    int i = 0;
+    for (; i + 4 <= length; i += 4){
+        __m128i below = _mm_cmplt_epi32(_mm_loadu_si128((const __m128i *)(sorted + i)), bounds);
+        int mask = _mm_movemask_ps(_mm_castsi128_ps(below));
+        // the masses are sorted, so the first block not all below holds the end
+        if (mask != 0xf) return i + __builtin_popcount(mask);
+    }
+    return i + countBelowScalar(sorted + i, length - i, bound);
+}
+
+/**
+ * Count the masses below bound 8 at a time with AVX2. Only called when the CPU has AVX2
+ *
+ * @param sorted    const FixedMass *   masses sorted smallest to largest
+ * @param length    int                 the number of masses
+ * @param bound     FixedMass           the bound to count below
+ *
+ * @return int      the number of masses < bound
+*/
+__attribute__((target("avx2")))
+inline int countBelowAvx2(const FixedMass * sorted, int length, FixedMass bound){
+    __m256i bounds = _mm256_set1_epi32(bound);
+
+    int i = 0;
+    for (; i + 8 <= length; i += 8){
+        __m256i below = _mm256_cmpgt_epi32(bounds, _mm256_loadu_si256((const __m256i *)(sorted + i)));
+        int mask = _mm256_movemask_ps(_mm256_castsi256_ps(below));
+        // the masses are sorted, so the first block not all below holds the end
+        if (mask != 0xff) return i + __builtin_popcount(mask);
+    }
+    return i + countBelowScalar(sorted + i, length - i, bound);
+}
+
+// true if the CPU running us has AVX2, checked once
+inline bool windowKernelHasAvx2(){
+    static const bool avx2 = __builtin_cpu_supports("avx2");
+    return avx2;
+}
+#endif
+
+/**
+ * Count the masses in a sorted array that are below a bound with the widest
+ * compares the CPU has, or a binary search if there are too many to scan
+ *
+ * @param sorted    const FixedMass *   masses sorted smallest to largest
+ * @param length    int                 the number of masses
+ * @param bound     FixedMass           the bound to count below
+ *
+ * @return int      the number of masses < bound, the same as lower_bound
+*/
+inline int countBelow(const FixedMass * sorted, int length, FixedMass bound){
+    if (length > WINDOW_KERNEL_MAX_SCAN) return (int)(lower_bound(sorted, sorted + length, bound) - sorted);
+
+#ifdef WINDOW_KERNEL_X86
+    if (windowKernelHasAvx2()) return countBelowAvx2(sorted, length, bound);
+    return countBelowSse2(sorted, length, bound);
+#else
+    return countBelowScalar(sorted, length, bound);
+#endif
+}
+/**
+ * Find the masses of a sorted array inside a window with the widest compares the
+ * CPU has, or two binary searches if there are too many to scan
+ *
+ * @param sorted        const FixedMass *   masses sorted smallest to largest
+ * @param length        int                 the number of masses
+ * @param lowerBound    FixedMass           the smallest mass in the window
+ * @param upperBound    FixedMass           the largest mass in the window
+ *
+ * @return WindowMatches    the range of masses in [lowerBound, upperBound], which starts
+ *                          where lower_bound would and is empty if upperBound < lowerBound
+*/
+inline WindowMatches findWindow(const FixedMass * sorted, int length, FixedMass lowerBound, FixedMass upperBound){
+    if (length > WINDOW_KERNEL_MAX_SCAN || upperBound < lowerBound){
+        int start = countBelow(sorted, length, lowerBound);
+        int end = upperBound < lowerBound ? start : (int)(upper_bound(sorted + start, sorted + length, upperBound) - sorted);
+        return WindowMatches {start, end};
+    }
+
+#ifdef WINDOW_KERNEL_X86
+    if (windowKernelHasAvx2()) return findWindowAvx2(sorted, length, lowerBound, upperBound);
+    return findWindowSse2(sorted, length, lowerBound, upperBound);
+#else
+    return findWindowScalar(sorted, length, lowerBound, upperBound);
+#endif
+}
+#endif
@@ -0,0 +1,339 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <string>
+#include <random>
+#include <chrono>
+#include <algorithm>
+#include <sstream>
+#include <sys/resource.h>
+
+#include "MassDawg.hpp"
+#include "FrozenMassDawg.hpp"
+#include "FastaDigester.hpp"
+#include "WindowKernel.hpp"
+
+using namespace std;
+
+// the seed of the synthetic proteome, so every run searches the same data
+#define PROTEOME_SEED       20201015
+#define PROTEIN_MIN_LENGTH  100
+#define PROTEIN_MAX_LENGTH  600
+#define QUERIES_PER_SIZE    500
+
+static const char RESIDUES[] = "ACDEFGHIKLMNPQRSTVWY";
+
+class Kmer {
+public:
+    string sequence;
+    vector<float> singlySequence;
+    vector<float> doublySequence;
+};
+
+/**
+ * Make a random proteome that is the same on every run
+ *
+ * @param proteins  int     the number of proteins to make
+ *
+ * @return vector<string>   the protein sequences
+*/
+vector<string> syntheticProteome(int proteins){
+    mt19937 rng(PROTEOME_SEED);
+    uniform_int_distribution<int> length(PROTEIN_MIN_LENGTH, PROTEIN_MAX_LENGTH);
+    uniform_int_distribution<int> residue(0, 19);
+
+    vector<string> proteome;
+    for (int p = 0; p < proteins; p++){
+        string protein;
+        int proteinLength = length(rng);
+        for (int i = 0; i < proteinLength; i++) protein += RESIDUES[residue(rng)];
+        proteome.push_back(protein);
+    }
+    return proteome;
+}
+
+/**
+ * Cut every protein into the kmers starting at each position (shorter at the
+ * end of the protein), sorted by mass for the fast insertion path
+ *
+ * @param proteome  vector<string>  the proteins
+ * @param maxK      int             the longest kmer
+ *
+ * @return vector<Kmer>     the distinct kmers with their masses
+*/
+vector<Kmer> digest(const vector<string> & proteome, int maxK){
+    vector<string> sequences;
+    for (const string & protein: proteome){
+        for (int i = 0; i < (int)protein.size(); i++) sequences.push_back(protein.substr(i, maxK));
+    }
+    sort(sequences.begin(), sequences.end());
+    sequences.erase(unique(sequences.begin(), sequences.end()), sequences.end());
+
+    vector<Kmer> kmers(sequences.size());
+    for (int i = 0; i < (int)sequences.size(); i++){
+        kmers[i].sequence = sequences[i];
+        FastaDigester::bIons(sequences[i], kmers[i].singlySequence, kmers[i].doublySequence);
+    }
+
+    sort(kmers.begin(), kmers.end(), [](const Kmer & a, const Kmer & b){
+        if (a.singlySequence != b.singlySequence) return a.singlySequence < b.singlySequence;
+        return a.doublySequence < b.doublySequence;
+    });
+    return kmers;
+}
+
+// seconds since start
+double secondsSince(chrono::steady_clock::time_point start){
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+// the largest resident set size of the process so far in megabytes
+double peakRssMb(){
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return usage.ru_maxrss / (1024.0 * 1024.0);
+#else
+    return usage.ru_maxrss / 1024.0;
+#endif
+}
+
+/**
+ * Print the 50th, 90th and 99th percentile and max of latencies
+ *
+ * @param label         string              what was timed
+ * @param latencies     vector<double>      latencies in seconds, sorted in place
+*/
+void printLatencies(const string & label, vector<double> & latencies){
+    sort(latencies.begin(), latencies.end());
+    auto percentile = [&](double p){ return latencies[(int)(p * (latencies.size() - 1))] * 1e6; };
+
+    printf("  %-28s p50 %9.1fus  p90 %9.1fus  p99 %9.1fus  max %9.1fus\n",
+        label.c_str(), percentile(.5), percentile(.9), percentile(.99), latencies.back() * 1e6);
+}
+
+/**
+ * Make the spectra to search. Each is the singly and doubly masses of a kmer in
+ * the graph with a few masses dropped and a few noise peaks added
+ *
+ * @param kmers     vector<Kmer>    the kmers in the graph
+ *
+ * @return vector<vector<float>>    the spectra
+*/
+vector<vector<float> > makeSpectra(const vector<Kmer> & kmers){
+    mt19937 rng(PROTEOME_SEED + 1);
+    uniform_real_distribution<float> noise(50, 3000);
+
+    vector<vector<float> > spectra;
+    for (int q = 0; q < QUERIES_PER_SIZE; q++){
+        const Kmer & kmer = kmers[rng() % kmers.size()];
+
+        vector<float> spectrum;
+        for (int i = 0; i < (int)kmer.singlySequence.size(); i++){
+            if (rng() % 10 != 0) spectrum.push_back(kmer.singlySequence[i]);
+            if (rng() % 10 != 0) spectrum.push_back(kmer.doublySequence[i]);
+        }
+        for (int i = 0; i < 3; i++) spectrum.push_back(noise(rng));
+
+        sort(spectrum.begin(), spectrum.end());
+        spectra.push_back(spectrum);
+    }
+    return spectra;
+}
+
+/**
+ * Time finding the peaks of every spectrum in the windows of many node masses,
+ * with the window kernel and with the binary searches it replaced
+ *
+ * @param kmers     vector<Kmer>            the kmers whose masses make the windows
+ * @param spectra   vector<vector<float>>   the spectra, sorted
+ * @param ppmTol    int                     the tolerance of the windows
+*/
+void benchmarkWindows(const vector<Kmer> & kmers, const vector<vector<float> > & spectra, int ppmTol){
+    mt19937 rng(PROTEOME_SEED + 2);
+    vector<FixedMass> lowers, uppers;
+    for (int i = 0; i < 1000; i++){
+        const Kmer & kmer = kmers[rng() % kmers.size()];
+        FixedMass mass = toFixedMass(kmer.singlySequence[rng() % kmer.singlySequence.size()]);
+        lowers.push_back(mass - ppmToFixed(mass, ppmTol));
+        uppers.push_back(mass + ppmToFixed(mass, ppmTol));
+    }
+
+    vector<vector<FixedMass> > peaks(spectra.size());
+    for (int s = 0; s < (int)spectra.size(); s++){
+        for (float mass: spectra[s]) peaks[s].push_back(toFixedMass(mass));
+    }
+    double windows = (double)lowers.size() * peaks.size();
+
+    // the matches are summed so neither loop can be optimized away
+    long binaryMatches = 0;
+    auto start = chrono::steady_clock::now();
+    for (const vector<FixedMass> & sorted: peaks){
+        for (int w = 0; w < (int)lowers.size(); w++){
+            vector<FixedMass>::const_iterator first = lower_bound(sorted.begin(), sorted.end(), lowers[w]);
+            binaryMatches += upper_bound(first, sorted.end(), uppers[w]) - first;
+        }
+    }
+    double binarySeconds = secondsSince(start);
+
+    long kernelMatches = 0;
+    start = chrono::steady_clock::now();
+    for (const vector<FixedMass> & sorted: peaks){
+        for (int w = 0; w < (int)lowers.size(); w++){
+            WindowMatches matches = findWindow(sorted.data(), (int)sorted.size(), lowers[w], uppers[w]);
+            kernelMatches += matches.end - matches.start;
+        }
+    }
+    double kernelSeconds = secondsSince(start);
+
+    printf("  %-28s %6.1fns per window (%ld matches)\n", ("windows lower_bound ppm " + to_string(ppmTol)).c_str(), binarySeconds * 1e9 / windows, binaryMatches);
+    printf("  %-28s %6.1fns per window (%ld matches)\n", ("windows kernel ppm " + to_string(ppmTol)).c_str(), kernelSeconds * 1e9 / windows, kernelMatches);
+}
+
+/**
+ * Build and search a graph from a number of proteins, printing the results
+ *
+ * @param proteins  int     the number of proteins in the proteome
+ * @param maxK      int     the longest kmer
+ * @param threads   int     the threads for the parallel build
+*/
+void benchmark(int proteins, int maxK, int threads){
+    vector<string> proteome = syntheticProteome(proteins);
+    vector<Kmer> kmers = digest(proteome, maxK);
+    printf("\n%d proteins, %d kmers of up to %d residues\n", proteins, (int)kmers.size(), maxK);
+
+    // streaming the proteome as FASTA, including computing and sorting the masses
+    stringstream fasta;
+    for (int p = 0; p < (int)proteome.size(); p++) fasta << ">protein" << p << "\n" << proteome[p] << "\n";
+
+    MassDawg * digested = new MassDawg();
+    FastaDigester digester(maxK);
+    auto start = chrono::steady_clock::now();
+    int digestedKmers = digester.digest(fasta, digested);
+    digested->finish();
+    double digestSeconds = secondsSince(start);
+    delete digested;
+
+    // serial build
+    MassDawg * md = new MassDawg();
+    start = chrono::steady_clock::now();
+    for (const Kmer & kmer: kmers) md->insert(kmer.singlySequence, kmer.doublySequence, kmer.sequence);
+    double insertSeconds = secondsSince(start);
+
+    start = chrono::steady_clock::now();
+    md->finish();
+    double finishSeconds = secondsSince(start);
+
+    printf("  insert                       %.3fs (%.0f inserts/sec)\n", insertSeconds, kmers.size() / insertSeconds);
+    printf("  finish                       %.3fs\n", finishSeconds);
+
+    MassDawgStats stats = md->stats();
+    const double MB = 1024.0 * 1024.0;
+    printf("  graph %.1fMB: nodes %.1fMB, kmer ids %.1fMB, children %.1fMB, kmers %.1fMB, minimized map %.1fMB, merge ratio %.2f\n",
+        stats.totalBytes() / MB, stats.nodeBytes / MB, stats.kmerIdBytes / MB, stats.childrenBytes / MB,
+        stats.kmerTableBytes / MB, stats.minimizedNodesBytes / MB, stats.mergeRatio);
+
+    // parallel build of the same kmers
+    vector<vector<float> > singlySequences, doublySequences;
+    vector<string> sequences;
+    for (const Kmer & kmer: kmers){
+        singlySequences.push_back(kmer.singlySequence);
+        doublySequences.push_back(kmer.doublySequence);
+        sequences.push_back(kmer.sequence);
+    }
+
+    MassDawg * parallel = new MassDawg();
+    start = chrono::steady_clock::now();
+    parallel->parallelInsert(singlySequences, doublySequences, sequences, threads);
+    double parallelSeconds = secondsSince(start);
+    delete parallel;
+
+    printf("  parallelInsert               %.3fs (%.0f inserts/sec)\n", parallelSeconds, kmers.size() / parallelSeconds);
+    printf("  FastaDigester                %.3fs (%.0f kmers/sec)\n", digestSeconds, digestedKmers / digestSeconds);
+
+    start = chrono::steady_clock::now();
+    FrozenMassDawg frozen(md);
+    double freezeSeconds = secondsSince(start);
+
+    printf("  freeze                       %.3fs\n", freezeSeconds);
+    printf("  nodes %d, edges %d, peak RSS %.1fMB\n", frozen.nodeCount(), frozen.edgeCount(), peakRssMb());
+
+    vector<vector<float> > spectra = makeSpectra(kmers);
+    vector<double> latencies;
+
+    for (int ppmTol: {10, 20}){
+        benchmarkWindows(kmers, spectra, ppmTol);
+
+        latencies.clear();
+        for (const vector<float> & spectrum: spectra){
+            start = chrono::steady_clock::now();
+            md->search(spectrum, ppmTol);
+            latencies.push_back(secondsSince(start));
+        }
+        printLatencies("search ppm " + to_string(ppmTol), latencies);
+
+        for (int gapAllowance = 0; gapAllowance <= 2; gapAllowance++){
+            latencies.clear();
+            for (const vector<float> & spectrum: spectra){
+                start = chrono::steady_clock::now();
+                md->fuzzySearch(spectrum, gapAllowance, ppmTol);
+                latencies.push_back(secondsSince(start));
+            }
+            printLatencies("fuzzySearch gap " + to_string(gapAllowance) + " ppm " + to_string(ppmTol), latencies);
+
+            latencies.clear();
+            for (const vector<float> & spectrum: spectra){
+                start = chrono::steady_clock::now();
+                frozen.fuzzySearch(spectrum, gapAllowance, ppmTol);
+                latencies.push_back(secondsSince(start));
+            }
+            printLatencies("frozen gap " + to_string(gapAllowance) + " ppm " + to_string(ppmTol), latencies);
+
+            latencies.clear();
+            for (const vector<float> & spectrum: spectra){
+                start = chrono::steady_clock::now();
+                frozen.memoizedFuzzySearch(spectrum, gapAllowance, ppmTol);
+                latencies.push_back(secondsSince(start));
+            }
+            printLatencies("frozen memo gap " + to_string(gapAllowance) + " ppm " + to_string(ppmTol), latencies);
+
+            frozen.bindTolerance(ppmTol);
+            latencies.clear();
+            for (const vector<float> & spectrum: spectra){
+                start = chrono::steady_clock::now();
+                frozen.fuzzySearch(spectrum, gapAllowance, ppmTol);
+                latencies.push_back(secondsSince(start));
+            }
+            frozen.bindTolerance(-1);
+            printLatencies("frozen bound gap " + to_string(gapAllowance) + " ppm " + to_string(ppmTol), latencies);
+
+            latencies.clear();
+            for (const vector<float> & spectrum: spectra){
+                start = chrono::steady_clock::now();
+                frozen.topKSearch(spectrum, 10, gapAllowance, ppmTol);
+                latencies.push_back(secondsSince(start));
+            }
+            printLatencies("frozen top 10 gap " + to_string(gapAllowance) + " ppm " + to_string(ppmTol), latencies);
+        }
+    }
+
+    delete md;
+}
+
+/**
+ * Usage: benchmark [maxK] [threads] [proteins ...]
+ *
+ * Builds and searches a graph from a synthetic proteome of each size
+*/
+int main(int argc, char ** argv){
+    int maxK = argc > 1 ? atoi(argv[1]) : 10;
+    int threads = argc > 2 ? atoi(argv[2]) : 0;
+
+    vector<int> sizes;
+    for (int i = 3; i < argc; i++) sizes.push_back(atoi(argv[i]));
+    if (sizes.empty()) sizes = {10, 100, 500};
+
+    for (int proteins: sizes) benchmark(proteins, maxK, threads);
+
+    return 0;
+}
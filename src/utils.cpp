@@ -1,3 +1,8 @@
+#include "utils.hpp"
+
+#include <cmath>
+#include <cstdlib>
+
 /**
  * Used for qsort on floats. If d1 < d2, a number < 0 returned
  * if d1 > d2, a number > 0 returned
@@ -17,4 +22,41 @@ int dblCmp(const void * d1, const void * d2){
 */
 float ppmToDa(float mass, int ppmTol){
     return ((float)ppmTol / 1000000.0) * mass;
-}
\ No newline at end of file
+}
+
+/**
+ * Check if a mass in daltons can be held by a FixedMass
+ * 
+ * @param mass      double  the mass in daltons
+ * 
+ * @return bool     True if the mass is in range, False if it is too large, too small or not a number
+*/
+bool fixedMassInRange(double mass){
+    // written so NaN is out of range
+    return fabs(mass * FIXED_MASS_SCALE) <= (double)INT32_MAX;
+}
+
+/**
+ * Convert a mass in daltons to the nearest FixedMass. Masses out of range are
+ * clamped to the smallest or largest FixedMass
+ * 
+ * @param mass      double  the mass in daltons
+ * 
+ * @return FixedMass    the mass in 1 / FIXED_MASS_SCALE daltons
+*/
+FixedMass toFixedMass(double mass){
+    if (fixedMassInRange(mass)) return (FixedMass)llround(mass * FIXED_MASS_SCALE);
+    return mass < 0 ? INT32_MIN : INT32_MAX;
+}
+
+/**
+ * Convert the ppm value of a given mass to a tolerance in the same fixed units
+ * 
+ * @param mass      FixedMass   the mass to calculate the tolerance for
+ * @param ppmTol    int         the tolerance in ppm
+ * 
+ * @return FixedMass    the tolerance, rounded to the nearest unit
+*/
+FixedMass ppmToFixed(FixedMass mass, int ppmTol){
+    return (FixedMass)((llabs((int64_t)mass) * ppmTol + 500000) / 1000000);
+}
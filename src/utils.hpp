@@ -1,6 +1,25 @@
 #ifndef UTILS_H
 #define UTILS_H
 
+#include <cstdint>
+
+// masses are stored and compared as integers of 1 / FIXED_MASS_SCALE daltons
+#define FIXED_MASS_SCALE    10000
+
+// the number of charge states kept for every node. Nodes hold one mass per
+// charge, 1 to MASSDAWG_CHARGES, and searches match a peak against each of them
+#ifndef MASSDAWG_CHARGES
+#define MASSDAWG_CHARGES    2
+#endif
+#if MASSDAWG_CHARGES < 1
+#error "MASSDAWG_CHARGES must be at least 1"
+#endif
+
+#define PROTON_MASS         1.00727646688
+
+// a mass in 1 / FIXED_MASS_SCALE daltons, enough for +-214748 Da
+typedef int32_t FixedMass;
+
 /**
  * Used for qsort on floats. If d1 < d2, a number < 0 returned
  * if d1 > d2, a number > 0 returned
@@ -17,4 +36,153 @@ int dblCmp(const void * d1, const void * d2);
  * @return float   the tolerance in daltons 
 */
 float ppmToDa(float mass, int ppmTol);
+
+// mix the bits of a hash table key so keys that only differ in their low bits spread out
+inline uint64_t mixKey(uint64_t key){
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    key *= 0xc4ceb9fe1a85ec53ULL;
+    key ^= key >> 33;
+    return key;
+}
+
+/**
+ * Check if a mass in daltons can be held by a FixedMass
+ * 
+ * @param mass      double  the mass in daltons
+ * 
+ * @return bool     True if the mass is in range, False if it is too large, too small or not a number
+*/
+bool fixedMassInRange(double mass);
+
+/**
+ * Convert a mass in daltons to the nearest FixedMass. Masses out of range are
+ * clamped to the smallest or largest FixedMass
+ * 
+ * @param mass      double  the mass in daltons
+ * 
+ * @return FixedMass    the mass in 1 / FIXED_MASS_SCALE daltons
+*/
+FixedMass toFixedMass(double mass);
+
+// the mass in daltons of a FixedMass
+inline double fixedMassToDa(FixedMass mass){
+    return (double)mass / FIXED_MASS_SCALE;
+}
+
+/**
+ * Convert the ppm value of a given mass to a tolerance in the same fixed units
+ * 
+ * @param mass      FixedMass   the mass to calculate the tolerance for
+ * @param ppmTol    int         the tolerance in ppm
+ * 
+ * @return FixedMass    the tolerance, rounded to the nearest unit
+*/
+FixedMass ppmToFixed(FixedMass mass, int ppmTol);
+
+// clamp a wide mass into the range of a FixedMass
+inline FixedMass clampFixedMass(int64_t mass){
+    return (FixedMass)(mass < INT32_MIN ? INT32_MIN : (mass > INT32_MAX ? INT32_MAX : mass));
+}
+
+/**
+ * The masses of a node at charges 1 to Charges, indexed by charge - 1. Compared
+ * lexicographically, so nodes order by their singly mass first
+*/
+template <int Charges>
+class ChargeMasses {
+public:
+    static const int charges = Charges;
+
+    FixedMass mass[Charges];
+
+    FixedMass & operator[](int i) { return this->mass[i]; }
+    const FixedMass & operator[](int i) const { return this->mass[i]; }
+
+    bool operator==(const ChargeMasses & other) const {
+        for (int z = 0; z < Charges; z++){
+            if (this->mass[z] != other.mass[z]) return false;
+        }
+        return true;
+    }
+    bool operator!=(const ChargeMasses & other) const { return !(*this == other); }
+
+    bool operator<(const ChargeMasses & other) const {
+        for (int z = 0; z < Charges; z++){
+            if (this->mass[z] != other.mass[z]) return this->mass[z] < other.mass[z];
+        }
+        return false;
+    }
+
+    /**
+     * Pack the masses into one integer key. Up to 2 charges the key is the masses
+     * themselves, more are mixed together and different masses can share a key
+     *
+     * @return uint64_t     the key of the masses
+    */
+    uint64_t hash() const {
+        uint64_t key = 0;
+        for (int z = 0; z < Charges; z++) key = (Charges <= 2 ? key << 32 : mixKey(key)) ^ (uint32_t)this->mass[z];
+        return key;
+    }
+};
+
+// the tolerance windows around the masses of a node at every charge, bounds included
+template <int Charges>
+class ChargeWindows {
+public:
+    static const int charges = Charges;
+
+    FixedMass lower[Charges];
+    FixedMass upper[Charges];
+};
+
+/**
+ * Compute the tolerance windows around the masses of a node
+ * 
+ * @param masses    ChargeMasses<Charges>   the masses at each charge
+ * @param ppmTol    int                     the tolerance in ppm
+ * 
+ * @return ChargeWindows<Charges>   the lower and upper bounds of every window
+*/
+template <int Charges>
+inline ChargeWindows<Charges> massWindows(const ChargeMasses<Charges> & masses, int ppmTol){
+    ChargeWindows<Charges> windows;
+    for (int z = 0; z < Charges; z++){
+        int64_t tolerance = ppmToFixed(masses[z], ppmTol);
+        windows.lower[z] = clampFixedMass((int64_t)masses[z] - tolerance);
+        windows.upper[z] = clampFixedMass((int64_t)masses[z] + tolerance);
+    }
+    return windows;
+}
+
+/**
+ * Fill in the masses of a node from its singly and doubly charged masses. Masses
+ * of charge 3 and up are computed from the singly mass, so the same inputs give
+ * the same nodes however many charges are kept
+ * 
+ * @param singlyMass    FixedMass   the singly charged mass
+ * @param doublyMass    FixedMass   the doubly charged mass
+ * 
+ * @return ChargeMasses<Charges>    the mass at each charge
+*/
+template <int Charges>
+inline ChargeMasses<Charges> chargeMasses(FixedMass singlyMass, FixedMass doublyMass){
+    ChargeMasses<Charges> masses;
+    masses[0] = singlyMass;
+    for (int z = 2; z <= Charges; z++){
+        masses[z - 1] = z == 2 ? doublyMass : toFixedMass((fixedMassToDa(singlyMass) + (z - 1) * PROTON_MASS) / z);
+    }
+    return masses;
+}
+
+// the masses and windows of the nodes of every graph in this build
+typedef ChargeMasses<MASSDAWG_CHARGES> NodeMasses;
+typedef ChargeWindows<MASSDAWG_CHARGES> MassWindows;
+
+// the masses of a node of this build from its singly and doubly charged masses
+inline NodeMasses nodeMasses(FixedMass singlyMass, FixedMass doublyMass){
+    return chargeMasses<MASSDAWG_CHARGES>(singlyMass, doublyMass);
+}
 #endif
\ No newline at end of file
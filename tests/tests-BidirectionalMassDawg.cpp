@@ -0,0 +1,134 @@
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+
+#include "catch.hpp"
+#include "../src/BidirectionalMassDawg.hpp"
+#include "../src/FastaDigester.hpp"
+
+using namespace std;
+
+// defined in tests-MassDawg.cpp
+bool hasString(vector<string> listOfString, string searching);
+
+// the singly charged b and y ions of a kmer, sorted like a spectrum
+vector<float> spectrumOf(const string & kmer){
+    vector<float> bSingly, bDoubly, ySingly, yDoubly;
+    FastaDigester::bIons(kmer, bSingly, bDoubly);
+    FastaDigester::yIons(kmer, ySingly, yDoubly);
+
+    vector<float> spectrum = bSingly;
+    spectrum.insert(spectrum.end(), ySingly.begin(), ySingly.end());
+    sort(spectrum.begin(), spectrum.end());
+    return spectrum;
+}
+
+TEST_CASE("Testing Bidirectional Mass Dawg"){
+    BidirectionalMassDawg * md = new BidirectionalMassDawg();
+
+    SECTION("A kmer is found by the b and y ions of its spectrum"){
+        md->insert("GAVK");
+        md->insert("MSTW");
+        md->finish();
+
+        REQUIRE(md->fuzzySearch(spectrumOf("GAVK"), 0, 10) == vector<string> {"GAVK"});
+        REQUIRE(md->search(spectrumOf("MSTW"), 10) == vector<string> {"MSTW"});
+    }
+
+    SECTION("A prefix shared by two kmers is joined only with the suffix its y ions find"){
+        md->insert("AGVK");
+        md->insert("GAVK");
+        md->finish();
+
+        // without the first b ion, AG and GA have the same b ions
+        vector<float> bSingly, bDoubly, ySingly, yDoubly;
+        FastaDigester::bIons("GAVK", bSingly, bDoubly);
+        FastaDigester::yIons("GAVK", ySingly, yDoubly);
+        vector<float> spectrum = {bSingly[1], bSingly[2], ySingly[0], ySingly[1], ySingly[2]};
+        sort(spectrum.begin(), spectrum.end());
+
+        vector<string> prefixes = md->bIonDawg()->fuzzySearch(spectrum, 1, 10);
+        REQUIRE(hasString(prefixes, "AGV"));
+        REQUIRE(hasString(prefixes, "GAV"));
+
+        REQUIRE(md->fuzzySearch(spectrum, 1, 10) == vector<string> {"GAVK"});
+    }
+
+    SECTION("A kmer is not returned when its prefix and suffix do not meet"){
+        md->insert("GAVKL");
+        md->finish();
+
+        vector<float> bSingly, bDoubly, ySingly, yDoubly;
+        FastaDigester::bIons("GAVKL", bSingly, bDoubly);
+        FastaDigester::yIons("GAVKL", ySingly, yDoubly);
+
+        // GA and KL leave V unexplained
+        vector<float> spectrum = {bSingly[0], bSingly[1], ySingly[0], ySingly[1]};
+        sort(spectrum.begin(), spectrum.end());
+        REQUIRE(md->fuzzySearch(spectrum, 0, 10).empty());
+
+        // GAV and KL meet
+        spectrum.push_back(bSingly[2]);
+        sort(spectrum.begin(), spectrum.end());
+        REQUIRE(md->fuzzySearch(spectrum, 0, 10) == vector<string> {"GAVKL"});
+    }
+
+    SECTION("A spectrum with no b ions finds nothing"){
+        md->insert("GAVK");
+        md->finish();
+
+        vector<float> ySingly, yDoubly;
+        FastaDigester::yIons("GAVK", ySingly, yDoubly);
+
+        REQUIRE(md->fuzzySearch(ySingly, 0, 10).empty());
+        REQUIRE(md->search(ySingly, 10).empty());
+        REQUIRE(md->search(nullptr, 0, 10).empty());
+    }
+
+    SECTION("The y ion graph holds the kmers reversed"){
+        md->insert("GAVK");
+        md->finish();
+
+        vector<float> ySingly, yDoubly;
+        FastaDigester::yIons("GAVK", ySingly, yDoubly);
+
+        REQUIRE(hasString(md->yIonDawg()->search(ySingly, 10), "KVAG"));
+    }
+
+    SECTION("A removed kmer is not found and both graphs keep the other kmers"){
+        md->insert("GAVK");
+        md->insert("GAVKL");
+        md->finish();
+
+        REQUIRE(md->remove("GAVK"));
+        REQUIRE(md->fuzzySearch(spectrumOf("GAVK"), 0, 10).empty());
+        REQUIRE(md->search(spectrumOf("GAVKL"), 10) == vector<string> {"GAVKL"});
+        REQUIRE_FALSE(md->remove("GAVK"));
+
+        // y ions that were never inserted leave the b ions in place as well
+        vector<float> bSingly, bDoubly, ySingly, yDoubly;
+        FastaDigester::bIons("GAVKL", bSingly, bDoubly);
+        FastaDigester::yIons("GAVKL", ySingly, yDoubly);
+        ySingly[0] += 1;
+        REQUIRE_FALSE(md->remove(bSingly, bDoubly, ySingly, yDoubly, "GAVKL"));
+        REQUIRE(md->search(spectrumOf("GAVKL"), 10) == vector<string> {"GAVKL"});
+
+        REQUIRE(md->remove("GAVKL"));
+        REQUIRE(md->bIonDawg()->stats().nodes == 1);
+        REQUIRE(md->yIonDawg()->stats().nodes == 1);
+        REQUIRE_THROWS_AS(md->remove("GXK"), invalid_argument);
+    }
+
+    SECTION("Inserting a kmer with an unknown residue or masses of different lengths throws an error"){
+        REQUIRE_THROWS_AS(md->insert("GXK"), invalid_argument);
+        REQUIRE_THROWS_AS(md->insert(""), invalid_argument);
+        REQUIRE_THROWS_AS(md->insert({100.1, 200.2}, {50.05, 100.1}, {120.1}, {60.05}, "GA"), invalid_argument);
+        REQUIRE_THROWS_AS(md->insert({100.1, 200.2}, {50.05, 100.1}, {120.1, 300000}, {60.05, 150.1}, "GA"), invalid_argument);
+
+        // neither graph was changed
+        REQUIRE(md->bIonDawg()->stats().kmers == 0);
+        REQUIRE(md->yIonDawg()->stats().kmers == 0);
+    }
+
+    delete md;
+}
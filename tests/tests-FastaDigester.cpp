@@ -0,0 +1,123 @@
+#include <vector>
+#include <sstream>
+#include <stdexcept>
+
+#include "catch.hpp"
+#include "../src/FastaDigester.hpp"
+
+using namespace std;
+
+// defined in tests-MassDawg.cpp
+bool hasString(vector<string> listOfString, string searching);
+
+TEST_CASE("Testing Fasta Digester"){
+    MassDawg * md = new MassDawg();
+
+    SECTION("The b ions of a kmer are the summed residue masses plus one or two protons"){
+        vector<float> singly, doubly;
+        REQUIRE(FastaDigester::bIons("GA", singly, doubly));
+
+        REQUIRE(singly.size() == 2);
+        REQUIRE(singly[0] == Approx(57.02146 + PROTON_MASS));
+        REQUIRE(singly[1] == Approx(57.02146 + 71.03711 + PROTON_MASS));
+        REQUIRE(doubly[1] == Approx((57.02146 + 71.03711 + 2 * PROTON_MASS) / 2));
+    }
+
+    SECTION("A kmer with an unknown residue has no b ions"){
+        vector<float> singly, doubly;
+
+        REQUIRE_FALSE(FastaDigester::bIons("GXA", singly, doubly));
+    }
+
+    SECTION("The y ions of a kmer are the summed residue masses of each suffix plus water and one or two protons"){
+        vector<float> singly, doubly;
+        REQUIRE(FastaDigester::yIons("GA", singly, doubly));
+
+        REQUIRE(singly.size() == 2);
+        REQUIRE(singly[0] == Approx(71.03711 + WATER_MASS + PROTON_MASS));
+        REQUIRE(singly[1] == Approx(57.02146 + 71.03711 + WATER_MASS + PROTON_MASS));
+        REQUIRE(doubly[0] == Approx((71.03711 + WATER_MASS + 2 * PROTON_MASS) / 2));
+        REQUIRE_FALSE(FastaDigester::yIons("GXA", singly, doubly));
+    }
+
+    SECTION("Every position of every protein is inserted and can be found by its masses"){
+        stringstream fasta(">sp|first\nMACG\nLV\n>sp|second\nwyk\n");
+        FastaDigester digester(3);
+
+        REQUIRE(digester.digest(fasta, md) == 9);
+        md->finish();
+
+        vector<float> singly, doubly;
+        for (string kmer: {"MAC", "ACG", "CGL", "GLV", "LV", "V", "WYK", "YK", "K"}){
+            FastaDigester::bIons(kmer, singly, doubly);
+            REQUIRE(hasString(md->search(singly, 10), kmer));
+        }
+
+        FastaDigester::bIons("MA", singly, doubly);
+        REQUIRE(hasString(md->search(singly, 10), "MA"));
+    }
+
+    SECTION("Kmers stop before residues without a mass"){
+        stringstream fasta(">protein\nGAXGA\n");
+        FastaDigester digester(5);
+
+        REQUIRE(digester.digest(fasta, md) == 4);
+        md->finish();
+
+        vector<float> singly, doubly;
+        FastaDigester::bIons("GA", singly, doubly);
+        REQUIRE(hasString(md->search(singly, 10), "GA"));
+    }
+
+    SECTION("Small chunks insert the same kmers as one chunk"){
+        string proteins = ">a\nMKWVTFISLLFLFSSAYS\n>b\nRGVFRRDAHKSEVAHRFK\n>c\nDLGEENFKALVLIAFAQY\n";
+        stringstream fasta1(proteins), fasta2(proteins);
+        MassDawg chunked;
+        FastaDigester oneChunk(6), smallChunks(6, 7);
+
+        REQUIRE(oneChunk.digest(fasta1, md) == smallChunks.digest(fasta2, &chunked));
+        md->finish();
+        chunked.finish();
+
+        vector<float> singly, doubly;
+        for (string kmer: {"MKWVTF", "SAYS", "RGVFRR", "FK", "AFAQY", "Y"}){
+            FastaDigester::bIons(kmer, singly, doubly);
+            REQUIRE(hasString(md->search(singly, 10), kmer));
+            REQUIRE(hasString(chunked.search(singly, 10), kmer));
+        }
+    }
+
+    SECTION("Removing a protein keeps the kmers other proteins share with it"){
+        string kept = ">kept\nMKWVTFISLL\n", removed = ">removed\nFISLLGAVKR\n";
+        stringstream both(kept + removed), removedFasta(removed), keptFasta(kept);
+        MassDawg keptOnly;
+        FastaDigester digester(4);
+
+        REQUIRE(digester.digest(both, md) == 20);
+        REQUIRE(digester.undigest(removedFasta, md) == 10);
+        REQUIRE(digester.digest(keptFasta, &keptOnly) == 10);
+        keptOnly.finish();
+
+        REQUIRE(md->stats().nodes == keptOnly.stats().nodes);
+        REQUIRE(md->stats().edges == keptOnly.stats().edges);
+
+        vector<float> singly, doubly;
+        FastaDigester::bIons("FISL", singly, doubly);
+        REQUIRE(hasString(md->search(singly, 10), "FISL"));
+        FastaDigester::bIons("GAVK", singly, doubly);
+        REQUIRE_FALSE(hasString(md->search(singly, 10), "GAVK"));
+
+        // proteins are read the same way digest reads them
+        REQUIRE(digester.removeProtein("mkwvtf\nisll", md) == 10);
+        REQUIRE(md->stats().nodes == 1);
+        REQUIRE(digester.removeProtein("MKWVTFISLL", md) == 0);
+    }
+
+    SECTION("A missing file throws an error"){
+        FastaDigester digester(5);
+
+        REQUIRE_THROWS_AS(digester.digestFile("not_a_real_file.fasta", md), runtime_error);
+    }
+
+    delete md;
+}
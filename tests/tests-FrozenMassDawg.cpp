@@ -0,0 +1,336 @@
+#include <vector>
+#include <algorithm>
+#include <fstream>
+#include <cstdio>
+#include <stdexcept>
+
+#include "catch.hpp"
+#include "../src/MassDawg.hpp"
+#include "../src/FrozenMassDawg.hpp"
+
+using namespace std;
+
+static vector<string> sorted(vector<string> results){
+    sort(results.begin(), results.end());
+    return results;
+}
+
+TEST_CASE("Testing Frozen Mass Dawg"){
+    MassDawg * md = new MassDawg();
+
+    string searchString1 = "ABCD";
+    vector<float> singlySearchSeq1 = {200.2, 400.4, 600.6, 800.8};
+    vector<float> doublySearchSeq1 = {100.1, 200.2, 300.3, 400.4};
+
+    string searchString2 = "ABYZ";
+    vector<float> singlySearchSeq2 = {200.2, 400.4, 700.7, 900.9};
+    vector<float> doublySearchSeq2 = {100.1, 200.2, 350.35, 450.45};
+
+    string searchString3 = "WXYZ";
+    vector<float> singlySearchSeq3 = {100.1, 340.34, 700.7, 900.9};
+    vector<float> doublySearchSeq3 = {50.05, 170.17, 350.35, 450.45};
+
+    string searchString5 = "DEFG";
+    vector<float> singlySearchSeq5 = {150.15, 380.38, 750.75, 980.98};
+    vector<float> doublySearchSeq5 = {75.075, 190.19, 325.325, 490.49};
+
+    md->insert(singlySearchSeq3, doublySearchSeq3, searchString3);
+    md->insert(singlySearchSeq5, doublySearchSeq5, searchString5);
+    md->insert(singlySearchSeq1, doublySearchSeq1, searchString1);
+    md->insert(singlySearchSeq2, doublySearchSeq2, searchString2);
+
+    FrozenMassDawg * frozen = new FrozenMassDawg(md);
+
+    SECTION("Freezing a graph keeps every node, edge and kmer of the finished graph"){
+        // root + W, WX, WXY, WXYZ, D, DE, DEF, DEFG, A, AB, ABC, ABCD, ABY merged into WXY, ABYZ into WXYZ
+        REQUIRE(frozen->nodeCount() == 13);
+        REQUIRE(frozen->childCount(frozen->root()) == 3);
+
+        REQUIRE(frozen->kmerCount() > 0);
+        for (int i = 0; i < frozen->kmerCount(); i++) REQUIRE_FALSE(frozen->kmer(i).empty());
+    }
+
+    SECTION("Freezing leaves out the kmers that were removed from the graph"){
+        MassDawg swapped;
+        swapped.insert(singlySearchSeq1, doublySearchSeq1, searchString1);
+        swapped.insert(singlySearchSeq2, doublySearchSeq2, searchString2);
+        swapped.insert(singlySearchSeq3, doublySearchSeq3, searchString3);
+        REQUIRE(swapped.remove(singlySearchSeq2, doublySearchSeq2, searchString2));
+
+        // ABY and ABYZ stay in the kmer table of the graph, AB and A are still held by ABCD
+        REQUIRE(swapped.stats().deadKmers == 2);
+
+        MassDawg rebuilt;
+        rebuilt.insert(singlySearchSeq1, doublySearchSeq1, searchString1);
+        rebuilt.insert(singlySearchSeq3, doublySearchSeq3, searchString3);
+        REQUIRE(rebuilt.stats().deadKmers == 0);
+
+        FrozenMassDawg swappedFrozen(&swapped);
+        FrozenMassDawg rebuiltFrozen(&rebuilt);
+
+        vector<string> swappedKmers, rebuiltKmers;
+        for (int i = 0; i < swappedFrozen.kmerCount(); i++) swappedKmers.push_back(swappedFrozen.kmer(i));
+        for (int i = 0; i < rebuiltFrozen.kmerCount(); i++) rebuiltKmers.push_back(rebuiltFrozen.kmer(i));
+        REQUIRE(sorted(swappedKmers) == sorted(rebuiltKmers));
+        REQUIRE(swappedFrozen.maxDepth() == rebuiltFrozen.maxDepth());
+        REQUIRE(sorted(swappedFrozen.fuzzySearch(singlySearchSeq1, 1, 10)) == sorted(rebuiltFrozen.fuzzySearch(singlySearchSeq1, 1, 10)));
+
+        // the characters of the removed kmers are not saved either
+        swappedFrozen.save("frozen_test_swapped.massdawg");
+        rebuiltFrozen.save("frozen_test_rebuilt.massdawg");
+        ifstream swappedFile("frozen_test_swapped.massdawg", ios::binary | ios::ate);
+        ifstream rebuiltFile("frozen_test_rebuilt.massdawg", ios::binary | ios::ate);
+        REQUIRE(swappedFile.tellg() == rebuiltFile.tellg());
+        swappedFile.close();
+        rebuiltFile.close();
+
+        FrozenMassDawg * loaded = FrozenMassDawg::load("frozen_test_swapped.massdawg");
+        REQUIRE(loaded->kmerCount() == rebuiltFrozen.kmerCount());
+        delete loaded;
+        remove("frozen_test_swapped.massdawg");
+        remove("frozen_test_rebuilt.massdawg");
+    }
+
+    SECTION("Fuzzy searching the frozen graph gives the same results as the graph it was built from"){
+        for (int gaps = 0; gaps < 3; gaps++){
+            REQUIRE(sorted(frozen->fuzzySearch(singlySearchSeq1, gaps, 10)) == sorted(md->fuzzySearch(singlySearchSeq1, gaps, 10)));
+            REQUIRE(sorted(frozen->fuzzySearch(singlySearchSeq2, gaps, 10)) == sorted(md->fuzzySearch(singlySearchSeq2, gaps, 10)));
+            REQUIRE(sorted(frozen->fuzzySearch({200.2, 700.7, 900.9}, gaps, 10)) == sorted(md->fuzzySearch({200.2, 700.7, 900.9}, gaps, 10)));
+            REQUIRE(frozen->fuzzySearch(singlySearchSeq1.data(), 4, gaps, 10) == frozen->fuzzySearch(singlySearchSeq1, gaps, 10));
+            REQUIRE(frozen->memoizedFuzzySearch(singlySearchSeq2, gaps, 10) == frozen->fuzzySearch(singlySearchSeq2, gaps, 10));
+            REQUIRE(frozen->memoizedFuzzySearch({700.7, 900.9}, gaps, 10) == frozen->fuzzySearch({700.7, 900.9}, gaps, 10));
+        }
+
+        vector<string> results = frozen->fuzzySearch(singlySearchSeq2, 0, 10);
+        REQUIRE(find(results.begin(), results.end(), searchString2) != results.end());
+        REQUIRE(find(results.begin(), results.end(), searchString3) != results.end());
+    }
+
+    SECTION("Searching the frozen graph gives the same results as the graph it was built from"){
+        REQUIRE(sorted(frozen->search(singlySearchSeq1, 10)) == sorted(md->search(singlySearchSeq1, 10)));
+        REQUIRE(sorted(frozen->search(singlySearchSeq5, 10)) == sorted(md->search(singlySearchSeq5, 10)));
+        REQUIRE(sorted(frozen->search({200.2, 400.4}, 10)) == sorted(md->search({200.2, 400.4}, 10)));
+        REQUIRE(frozen->search({}, 10).empty());
+        REQUIRE(frozen->search(singlySearchSeq5.data(), 4, 10) == frozen->search(singlySearchSeq5, 10));
+    }
+
+    SECTION("A top k search of the frozen graph gives the same results as the graph it was built from"){
+        vector<float> spectrum = {200.2, 400.4, 700.7, 900.9, 600.6, 380.38};
+        vector<float> intensities = {5, 1, 2, 3, 8, 4};
+
+        for (int k = 1; k < 5; k++){
+            for (int gaps = 0; gaps < 3; gaps++){
+                vector<ScoredKmer> expected = md->topKSearch(spectrum, k, gaps, 10, intensities);
+                vector<ScoredKmer> results = frozen->topKSearch(spectrum, k, gaps, 10, intensities);
+
+                REQUIRE(results.size() == expected.size());
+                for (int i = 0; i < (int)results.size(); i++){
+                    REQUIRE(results[i].kmer == expected[i].kmer);
+                    REQUIRE(results[i].score == expected[i].score);
+                }
+            }
+        }
+    }
+
+    SECTION("Binding a tolerance does not change the results of any search"){
+        vector<float> spectrum = {200.2, 400.4, 700.7, 900.9, 600.6, 380.38};
+        REQUIRE(frozen->boundTolerance() == -1);
+
+        vector<vector<string> > expected;
+        for (int ppm: {10, 20}){
+            for (int gaps = 0; gaps < 3; gaps++) expected.push_back(frozen->fuzzySearch(spectrum, gaps, ppm));
+            expected.push_back(frozen->search(spectrum, ppm));
+        }
+
+        frozen->bindTolerance(10);
+        REQUIRE(frozen->boundTolerance() == 10);
+
+        vector<vector<string> > results;
+        for (int ppm: {10, 20}){
+            for (int gaps = 0; gaps < 3; gaps++) results.push_back(frozen->fuzzySearch(spectrum, gaps, ppm));
+            results.push_back(frozen->search(spectrum, ppm));
+        }
+        REQUIRE(results == expected);
+
+        vector<ScoredKmer> top = frozen->topKSearch(spectrum, 3, 1, 10);
+        vector<ScoredKmer> unbound = md->topKSearch(spectrum, 3, 1, 10);
+        REQUIRE(top.size() == unbound.size());
+        for (int i = 0; i < (int)top.size(); i++) REQUIRE(top[i].kmer == unbound[i].kmer);
+
+        frozen->bindTolerance(-1);
+        REQUIRE(frozen->boundTolerance() == -1);
+        REQUIRE(frozen->fuzzySearch(spectrum, 1, 10) == expected[1]);
+    }
+
+    SECTION("The frozen graph can be searched after the graph it was built from is deleted"){
+        vector<string> expected = sorted(md->fuzzySearch(singlySearchSeq3, 1, 10));
+        delete md;
+        md = nullptr;
+
+        REQUIRE(sorted(frozen->fuzzySearch(singlySearchSeq3, 1, 10)) == expected);
+    }
+
+    SECTION("A saved graph loads with the same nodes, edges, kmers and search results"){
+        frozen->save("frozen_test.massdawg");
+        FrozenMassDawg * loaded = FrozenMassDawg::load("frozen_test.massdawg");
+
+        REQUIRE(loaded->nodeCount() == frozen->nodeCount());
+        REQUIRE(loaded->edgeCount() == frozen->edgeCount());
+        REQUIRE(loaded->kmerCount() == frozen->kmerCount());
+        REQUIRE(loaded->maxDepth() == frozen->maxDepth());
+        for (int i = 0; i < frozen->kmerCount(); i++) REQUIRE(loaded->kmer(i) == frozen->kmer(i));
+
+        for (int gaps = 0; gaps < 3; gaps++){
+            REQUIRE(sorted(loaded->fuzzySearch(singlySearchSeq2, gaps, 10)) == sorted(frozen->fuzzySearch(singlySearchSeq2, gaps, 10)));
+            REQUIRE(sorted(loaded->fuzzySearch({200.2, 700.7, 900.9}, gaps, 10)) == sorted(frozen->fuzzySearch({200.2, 700.7, 900.9}, gaps, 10)));
+        }
+        REQUIRE(sorted(loaded->search(singlySearchSeq5, 10)) == sorted(frozen->search(singlySearchSeq5, 10)));
+
+        // a loaded graph can be saved again
+        loaded->save("frozen_test_copy.massdawg");
+        FrozenMassDawg * copy = FrozenMassDawg::load("frozen_test_copy.massdawg");
+        REQUIRE(sorted(copy->fuzzySearch(singlySearchSeq1, 1, 10)) == sorted(frozen->fuzzySearch(singlySearchSeq1, 1, 10)));
+
+        delete copy;
+        delete loaded;
+        remove("frozen_test.massdawg");
+        remove("frozen_test_copy.massdawg");
+    }
+
+    SECTION("Loading a file that is not a saved graph of this version throws an error"){
+        REQUIRE_THROWS_AS(FrozenMassDawg::load("not_a_real_file.massdawg"), runtime_error);
+
+        ofstream notAGraph("frozen_test_bad.massdawg");
+        notAGraph << "this is not a graph, but it is long enough to hold a header";
+        notAGraph.close();
+        REQUIRE_THROWS_AS(FrozenMassDawg::load("frozen_test_bad.massdawg"), runtime_error);
+
+        // the version follows the 8 byte magic
+        frozen->save("frozen_test_bad.massdawg");
+        fstream file("frozen_test_bad.massdawg", ios::in | ios::out | ios::binary);
+        uint32_t version = FROZEN_FORMAT_VERSION + 1;
+        file.seekp(8);
+        file.write((const char *)&version, sizeof(version));
+        file.close();
+        REQUIRE_THROWS_AS(FrozenMassDawg::load("frozen_test_bad.massdawg"), runtime_error);
+
+        // a graph saved by a build with another number of charges says so. The
+        // charges follow the magic, the version and the byte order
+        frozen->save("frozen_test_bad.massdawg");
+        file.open("frozen_test_bad.massdawg", ios::in | ios::out | ios::binary);
+        uint32_t charges = MASSDAWG_CHARGES + 1;
+        file.seekp(16);
+        file.write((const char *)&charges, sizeof(charges));
+        file.close();
+        REQUIRE_THROWS_WITH(FrozenMassDawg::load("frozen_test_bad.massdawg"), Catch::Contains("MASSDAWG_CHARGES=" + to_string(charges)));
+
+        // a header that claims no kmers leaves every kmer id of the nodes out of bounds.
+        // The number of kmers follows the magic and 6 other fields
+        frozen->save("frozen_test_bad.massdawg");
+        file.open("frozen_test_bad.massdawg", ios::in | ios::out | ios::binary);
+        uint32_t kmers = 0;
+        file.seekp(32);
+        file.write((const char *)&kmers, sizeof(kmers));
+        file.close();
+        REQUIRE_THROWS_AS(FrozenMassDawg::load("frozen_test_bad.massdawg"), runtime_error);
+
+        // a number of characters so large that the size of the layout wraps around.
+        // It follows the 7 other counts at the first 8 byte boundary
+        frozen->save("frozen_test_bad.massdawg");
+        file.open("frozen_test_bad.massdawg", ios::in | ios::out | ios::binary);
+        uint64_t chars = UINT64_MAX - 7;
+        file.seekp(40);
+        file.write((const char *)&chars, sizeof(chars));
+        file.close();
+        REQUIRE_THROWS_AS(FrozenMassDawg::load("frozen_test_bad.massdawg"), runtime_error);
+
+        // children out of order would be skipped by a search instead of found.
+        // The children follow the 48 byte header, the masses and the child offsets
+        frozen->save("frozen_test_bad.massdawg");
+        file.open("frozen_test_bad.massdawg", ios::in | ios::out | ios::binary);
+        size_t massBytes = ((size_t)frozen->nodeCount() * MASSDAWG_CHARGES * sizeof(FixedMass) + 7) & ~(size_t)7;
+        size_t offsetBytes = ((size_t)(frozen->nodeCount() + 1) * sizeof(uint32_t) + 7) & ~(size_t)7;
+        uint32_t rootChildren[2];
+        file.seekg(48 + massBytes + offsetBytes);
+        file.read((char *)rootChildren, sizeof(rootChildren));
+        swap(rootChildren[0], rootChildren[1]);
+        file.seekp(48 + massBytes + offsetBytes);
+        file.write((const char *)rootChildren, sizeof(rootChildren));
+        file.close();
+        REQUIRE_THROWS_AS(FrozenMassDawg::load("frozen_test_bad.massdawg"), runtime_error);
+        // and the swap is all that is wrong with it
+        FrozenMassDawg * unchecked = FrozenMassDawg::load("frozen_test_bad.massdawg", false);
+        REQUIRE(unchecked->nodeCount() == frozen->nodeCount());
+        delete unchecked;
+
+        remove("frozen_test_bad.massdawg");
+    }
+
+    SECTION("A trusted file can be loaded without checking its arrays"){
+        frozen->save("frozen_test.massdawg");
+        FrozenMassDawg * loaded = FrozenMassDawg::load("frozen_test.massdawg", false);
+
+        REQUIRE(loaded->nodeCount() == frozen->nodeCount());
+        REQUIRE(sorted(loaded->fuzzySearch(singlySearchSeq2, 1, 10)) == sorted(frozen->fuzzySearch(singlySearchSeq2, 1, 10)));
+
+        delete loaded;
+        remove("frozen_test.massdawg");
+    }
+
+    delete frozen;
+    delete md;
+}
+
+TEST_CASE("Testing batch fuzzy search"){
+    MassDawg * md = new MassDawg();
+
+    vector<vector<float> > singly = {
+        {200.2, 400.4, 600.6, 800.8},
+        {200.2, 400.4, 700.7, 900.9},
+        {100.1, 340.34, 700.7, 900.9},
+        {150.15, 380.38, 750.75, 980.98}
+    };
+    vector<vector<float> > doubly = {
+        {100.1, 200.2, 300.3, 400.4},
+        {100.1, 200.2, 350.35, 450.45},
+        {50.05, 170.17, 350.35, 450.45},
+        {75.075, 190.19, 325.325, 490.49}
+    };
+    vector<string> kmers = {"ABCD", "ABYZ", "WXYZ", "DEFG"};
+
+    for (int i = 0; i < (int)kmers.size(); i++) md->insert(singly[i], doubly[i], kmers[i]);
+    md->finish();
+
+    // enough spectra that every thread gets more than one
+    vector<vector<float> > spectra;
+    for (int i = 0; i < 50; i++){
+        vector<float> spectrum = singly[i % singly.size()];
+        if (i % 3 == 0) spectrum.erase(spectrum.begin() + 1);
+        spectra.push_back(spectrum);
+    }
+
+    SECTION("Batch searching the graph gives the results of each search in the order of the spectra"){
+        for (int threads: {1, 4, 0}){
+            vector<vector<string> > results = md->batchFuzzySearch(spectra, 1, 10, threads);
+
+            REQUIRE(results.size() == spectra.size());
+            for (int i = 0; i < (int)spectra.size(); i++) REQUIRE(results[i] == md->fuzzySearch(spectra[i], 1, 10));
+        }
+    }
+
+    SECTION("Batch searching the frozen graph gives the results of each search in the order of the spectra"){
+        FrozenMassDawg * frozen = new FrozenMassDawg(md);
+        vector<vector<string> > results = frozen->batchFuzzySearch(spectra, 1, 10, 4);
+
+        REQUIRE(results.size() == spectra.size());
+        for (int i = 0; i < (int)spectra.size(); i++) REQUIRE(results[i] == frozen->fuzzySearch(spectra[i], 1, 10));
+
+        delete frozen;
+    }
+
+    SECTION("Batch searching no spectra gives no results"){
+        REQUIRE(md->batchFuzzySearch(vector<vector<float> > {}, 1, 10, 4).empty());
+    }
+
+    delete md;
+}
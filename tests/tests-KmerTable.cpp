@@ -0,0 +1,75 @@
+#include <vector>
+
+#include "catch.hpp"
+#include "../src/KmerTable.hpp"
+
+using namespace std;
+
+TEST_CASE("Kmer Table test cases"){
+    KmerTable * table = new KmerTable();
+
+    SECTION("Interning a kmer gives an id that maps back to the same kmer"){
+        uint32_t id = table->intern("ABCD");
+
+        REQUIRE(table->get(id) == "ABCD");
+        REQUIRE(table->size() == 1);
+    }
+
+    SECTION("Interning the same kmer twice gives the same id"){
+        uint32_t first = table->intern("ABCD");
+        uint32_t second = table->intern("ABCD");
+        uint32_t other = table->intern("ABCE");
+
+        REQUIRE(first == second);
+        REQUIRE(first != other);
+        REQUIRE(table->size() == 2);
+    }
+
+    SECTION("The table knows the length of its longest kmer"){
+        REQUIRE(table->maxLength() == 0);
+
+        table->intern("ABC");
+        vector<uint32_t> ids;
+        table->internPrefixes("ABCDE", ids);
+        table->intern("XY");
+
+        REQUIRE(table->maxLength() == 5);
+    }
+
+    SECTION("Interning the prefixes of a kmer gives one id per prefix without copying characters"){
+        vector<uint32_t> ids;
+        table->internPrefixes("ABCD", ids);
+
+        REQUIRE(ids.size() == 4);
+        REQUIRE(table->get(ids[0]) == "A");
+        REQUIRE(table->get(ids[1]) == "AB");
+        REQUIRE(table->get(ids[2]) == "ABC");
+        REQUIRE(table->get(ids[3]) == "ABCD");
+        REQUIRE(table->characters() == "ABCD");
+    }
+
+    SECTION("Prefixes shared between kmers are given the same id"){
+        vector<uint32_t> first;
+        vector<uint32_t> second;
+        table->internPrefixes("ABCD", first);
+        table->internPrefixes("ABYZ", second);
+
+        REQUIRE(first[0] == second[0]);
+        REQUIRE(first[1] == second[1]);
+        REQUIRE(first[2] != second[2]);
+        REQUIRE(table->intern("AB") == first[1]);
+        REQUIRE(table->size() == 6);
+    }
+
+    SECTION("The table keeps every kmer when it grows"){
+        vector<uint32_t> ids;
+        for (int i = 0; i < 5000; i++) ids.push_back(table->intern("K" + to_string(i)));
+
+        for (int i = 0; i < 5000; i++){
+            REQUIRE(table->get(ids[i]) == "K" + to_string(i));
+            REQUIRE(table->intern("K" + to_string(i)) == ids[i]);
+        }
+    }
+
+    delete table;
+}
@@ -1,4 +1,7 @@
 #include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include <cmath>
 
 #include "catch.hpp"
 #include "../src/MassDawg.hpp"
@@ -42,6 +45,11 @@ TEST_CASE("Testing Mass Dawg"){
         REQUIRE_NOTHROW(md->insert(singlySearchSeq1, doublySearchSeq1, searchString1));
     }
 
+    SECTION("Inserting masses and a kmer of different lengths throws an error"){
+        REQUIRE_THROWS(md->insert(singlySearchSeq1, doublySearchSeq1, "ABC"));
+        REQUIRE_THROWS(md->insert(singlySearchSeq1, {100.1}, searchString1));
+    }
+
     SECTION("Two insertions into graph throws no error and both kmers can be found"){
         REQUIRE_NOTHROW(md->insert(singlySearchSeq1, doublySearchSeq1, searchString1));
         REQUIRE_NOTHROW(md->insert(singlySearchSeq2, doublySearchSeq2, searchString2));
@@ -62,6 +70,20 @@ TEST_CASE("Testing Mass Dawg"){
         REQUIRE(hasString(md->search(singlySearchSeq2, 10), searchString2));
     }
 
+    SECTION("An out of order insertion is added to the end of its own common prefix"){
+        REQUIRE_NOTHROW(md->insert(singlySearchSeq1, doublySearchSeq1, searchString1));
+        REQUIRE_NOTHROW(md->insert(singlySearchSeq2, doublySearchSeq2, searchString2));
+        // shares ABC with ABCD but is smaller than ABYZ, the last insertion
+        REQUIRE_NOTHROW(md->insert({200.2, 400.4, 600.6, 700.0}, {100.1, 200.2, 300.3, 350.0}, "ABCE"));
+        REQUIRE_NOTHROW(md->finish());
+
+        REQUIRE(hasString(md->search({200.2, 400.4, 600.6, 700.0}, 10), "ABCE"));
+        REQUIRE(hasString(md->search(singlySearchSeq1, 10), searchString1));
+        REQUIRE(hasString(md->search(singlySearchSeq2, 10), searchString2));
+        REQUIRE_FALSE(hasString(md->search({200.2, 400.4, 600.6}, 10), "ABCE"));
+        REQUIRE(hasString(md->search({200.2, 400.4, 600.6}, 10), "ABC"));
+    }
+
     SECTION("Two insertions with a common prefix and a search only until the common prefix returns both kmers"){
         REQUIRE_NOTHROW(md->insert(singlySearchSeq1, doublySearchSeq1, searchString1));
         REQUIRE_NOTHROW(md->insert(singlySearchSeq2, doublySearchSeq2, searchString2));
@@ -141,4 +163,420 @@ TEST_CASE("Testing Mass Dawg"){
         REQUIRE_FALSE(hasString(results1, searchString5));
         REQUIRE(hasString(results1, searchString1));
     }
-}
\ No newline at end of file
+
+    SECTION("Stats count the nodes, edges and kmers of a graph with a shared prefix"){
+        md->insert(singlySearchSeq1, doublySearchSeq1, searchString1);
+        md->insert(singlySearchSeq2, doublySearchSeq2, searchString2);
+        md->finish();
+
+        MassDawgStats stats = md->stats();
+
+        // root, A, AB, ABC, ABCD, ABY, ABYZ
+        REQUIRE(stats.nodes == 7);
+        REQUIRE(stats.edges == 6);
+        REQUIRE(stats.kmers == 6);
+        REQUIRE(stats.mergeRatio == Approx(1.0));
+        REQUIRE(stats.fanoutHistogram == vector<int> {2, 4, 1});
+        REQUIRE(stats.depthHistogram == vector<int> {1, 1, 1, 2, 2});
+        REQUIRE(stats.nodeBytes > 0);
+        REQUIRE(stats.kmerTableBytes > 0);
+        REQUIRE(stats.totalBytes() > stats.nodeBytes);
+    }
+
+    SECTION("Stats show the nodes merged away by a shared suffix"){
+        md->insert(singlySearchSeq3, doublySearchSeq3, searchString3);
+        md->insert(singlySearchSeq4, doublySearchSeq4, searchString4);
+        md->finish();
+
+        MassDawgStats stats = md->stats();
+
+        // root, W, WX, M, MN and the shared XY, XYZ nodes hold 8 prefixes
+        REQUIRE(stats.nodes == 7);
+        REQUIRE(stats.kmers == 8);
+        REQUIRE(stats.mergeRatio == Approx(8.0 / 6));
+        REQUIRE(stats.depthHistogram == vector<int> {1, 2, 2, 1, 1});
+    }
+
+    SECTION("Inserting and searching arrays of masses works the same as vectors"){
+        REQUIRE_NOTHROW(md->insert(singlySearchSeq1.data(), doublySearchSeq1.data(), 4, searchString1));
+        REQUIRE_NOTHROW(md->insert(singlySearchSeq2.data(), doublySearchSeq2.data(), 4, searchString2));
+        REQUIRE_THROWS_AS(md->insert(singlySearchSeq3.data(), doublySearchSeq3.data(), 3, searchString3), invalid_argument);
+        md->finish();
+
+        REQUIRE(md->search(singlySearchSeq1.data(), 4, 10) == md->search(singlySearchSeq1, 10));
+        REQUIRE(md->fuzzySearch(singlySearchSeq2.data(), 4, 1, 10) == md->fuzzySearch(singlySearchSeq2, 1, 10));
+        REQUIRE(hasString(md->fuzzySearch(singlySearchSeq2.data(), 4, 0, 10), searchString2));
+        REQUIRE(md->search(nullptr, 0, 10).empty());
+        REQUIRE(md->fuzzySearch(nullptr, 0, 1, 10).empty());
+    }
+
+    SECTION("Masses too large for a FixedMass or not a number throw an error"){
+        vector<float> tooLarge = {200.2, 400.4, 600.6, 300000};
+        vector<float> notANumber = {200.2, 400.4, NAN, 800.8};
+
+        REQUIRE_THROWS_AS(md->insert(tooLarge, doublySearchSeq1, searchString1), invalid_argument);
+        REQUIRE_THROWS_AS(md->insert(singlySearchSeq1.data(), notANumber.data(), 4, searchString1), invalid_argument);
+        REQUIRE_THROWS_AS(md->parallelInsert({singlySearchSeq1, tooLarge}, {doublySearchSeq1, doublySearchSeq2}, {searchString1, searchString2}, 2), invalid_argument);
+    }
+
+    SECTION("Masses inserted in fixed point are found by a search in daltons"){
+        vector<NodeMasses> sequence;
+        for (int i = 0; i < 4; i++) sequence.push_back(nodeMasses(toFixedMass(singlySearchSeq1[i]), toFixedMass(doublySearchSeq1[i])));
+        REQUIRE_NOTHROW(md->insert(sequence.data(), 4, searchString1));
+        md->finish();
+
+        REQUIRE(hasString(md->search(singlySearchSeq1, 10), searchString1));
+    }
+
+    SECTION("Nodes merge only when their masses round to the same fixed point value"){
+        md->insert({200.2}, {100.1}, "A");
+        md->insert({200.20004}, {100.1}, "B");
+        md->insert({200.2001}, {100.1}, "C");
+        md->finish();
+
+        // A and B share a node, C is one unit of mass away and gets its own
+        REQUIRE(md->stats().nodes == 3);
+        vector<string> results = md->search({200.2}, 10);
+        REQUIRE(hasString(results, "A"));
+        REQUIRE(hasString(results, "B"));
+    }
+
+    SECTION("A top k search returns the best scoring kmers first"){
+        REQUIRE_NOTHROW(md->insert(singlySearchSeq1, doublySearchSeq1, searchString1));
+        REQUIRE_NOTHROW(md->insert(singlySearchSeq2, doublySearchSeq2, searchString2));
+        REQUIRE_NOTHROW(md->finish());
+
+        // ABYZ matches all 4 singly masses, ABCD only matches A, B and C before its gap
+        vector<float> spectrum = {200.2, 400.4, 700.7, 900.9, 600.6};
+        vector<ScoredKmer> results = md->topKSearch(spectrum, 2, 1, 10);
+
+        REQUIRE(results.size() == 2);
+        REQUIRE(results[0].kmer == searchString2);
+        REQUIRE(results[0].score == 4);
+        REQUIRE(results[1].kmer == "ABC");
+        REQUIRE(results[1].score == 3);
+
+        results = md->topKSearch(spectrum, 1, 1, 10);
+        REQUIRE(results.size() == 1);
+        REQUIRE(results[0].kmer == searchString2);
+
+        // a large enough intensity on C puts ABC first
+        results = md->topKSearch(spectrum, 2, 1, 10, {1, 1, 1, 1, 10});
+        REQUIRE(results.size() == 2);
+        REQUIRE(results[0].kmer == "ABC");
+        REQUIRE(results[0].score == Approx(12));
+        REQUIRE(results[1].kmer == searchString2);
+        REQUIRE(results[1].score == Approx(4));
+
+        REQUIRE(md->topKSearch(spectrum.data(), nullptr, 5, 2, 1, 10).size() == 2);
+        REQUIRE(md->topKSearch(spectrum, 0, 1, 10).empty());
+        REQUIRE(md->topKSearch({}, 2, 1, 10).empty());
+        REQUIRE_THROWS_AS(md->topKSearch(spectrum, 2, 1, 10, {1, 1}), invalid_argument);
+        REQUIRE_THROWS_AS(md->topKSearch(spectrum, 2, 1, 10, {1, 1, 1, 1, -1}), invalid_argument);
+    }
+
+    SECTION("A top k search breaks ties by kmer no matter the order the graph is walked in"){
+        // every kmer matches one mass, and the one that sorts first is walked last
+        REQUIRE_NOTHROW(md->insert({400.4}, {200.2}, "C"));
+        REQUIRE_NOTHROW(md->insert({500.5}, {250.25}, "B"));
+        REQUIRE_NOTHROW(md->insert({600.6}, {300.3}, "A"));
+        REQUIRE_NOTHROW(md->finish());
+
+        vector<float> spectrum = {400.4, 500.5, 600.6};
+        vector<ScoredKmer> all = md->topKSearch(spectrum, 100, 0, 10);
+        REQUIRE(all.size() == 3);
+        REQUIRE(all[0].kmer == "A");
+
+        for (int k = 1; k <= 3; k++){
+            vector<ScoredKmer> results = md->topKSearch(spectrum, k, 0, 10);
+
+            REQUIRE((int)results.size() == k);
+            for (int i = 0; i < k; i++){
+                REQUIRE(results[i].kmer == all[i].kmer);
+                REQUIRE(results[i].score == all[i].score);
+            }
+        }
+    }
+
+    SECTION("A spectrum of more than 64 masses is searched the same as a short one"){
+        REQUIRE_NOTHROW(md->insert(singlySearchSeq1, doublySearchSeq1, searchString1));
+        REQUIRE_NOTHROW(md->insert(singlySearchSeq2, doublySearchSeq2, searchString2));
+        REQUIRE_NOTHROW(md->finish());
+
+        // 62 masses below every node put the real ones across the first two words of the consumed bitmask
+        vector<float> spectrum;
+        for (int i = 1; i <= 62; i++) spectrum.push_back((float)i);
+        spectrum.insert(spectrum.end(), singlySearchSeq2.begin(), singlySearchSeq2.end());
+
+        REQUIRE(md->fuzzySearch(spectrum, 0, 10) == md->fuzzySearch(singlySearchSeq2, 0, 10));
+        REQUIRE(hasString(md->fuzzySearch(spectrum, 0, 10), searchString2));
+
+        vector<ScoredKmer> results = md->topKSearch(spectrum, 1, 0, 10);
+        REQUIRE(results.size() == 1);
+        REQUIRE(results[0].kmer == searchString2);
+        REQUIRE(results[0].score == 4);
+    }
+
+    SECTION("Search stats count the work of a search only when they are compiled in"){
+        REQUIRE_NOTHROW(md->insert(singlySearchSeq3, doublySearchSeq3, searchString3));
+        REQUIRE_NOTHROW(md->insert(singlySearchSeq2, doublySearchSeq2, searchString2));
+        REQUIRE_NOTHROW(md->finish());
+
+        SearchStats fuzzyStats;
+        vector<string> results = md->fuzzySearch({200.2, 700.7, 900.9}, 1, 10, &fuzzyStats);
+        REQUIRE(results == md->fuzzySearch({200.2, 700.7, 900.9}, 1, 10));
+
+        SearchStats searchStats;
+        vector<string> searchResults = md->search(singlySearchSeq2, 10, &searchStats);
+        REQUIRE(hasString(searchResults, searchString2));
+
+        // stats reused without a reset keep the deepest node of any of the searches
+        SearchStats reusedStats;
+        md->search(singlySearchSeq2, 10, &reusedStats);
+        md->search(singlySearchSeq2, 10, &reusedStats);
+        md->fuzzySearch({200.2, 700.7, 900.9}, 1, 10, &reusedStats);
+        md->fuzzySearch({200.2, 700.7, 900.9}, 1, 10, &reusedStats);
+
+        SearchStats topKStats;
+        REQUIRE(md->topKSearch(singlySearchSeq2, 1, 0, 10, {}, &topKStats)[0].kmer == searchString2);
+
+#ifdef MASSDAWG_SEARCH_STATS
+        REQUIRE(SearchStats::enabled());
+        REQUIRE(fuzzyStats.nodesVisited > 0);
+        REQUIRE(fuzzyStats.toleranceChecks == MassWindows::charges * fuzzyStats.nodesVisited);
+        REQUIRE(fuzzyStats.gapBranches > 0);
+        REQUIRE(fuzzyStats.maxDepth == 4);
+        REQUIRE(fuzzyStats.resultsEmitted == (long)results.size());
+
+        REQUIRE(searchStats.nodesVisited > 0);
+        REQUIRE(searchStats.gapBranches == 0);
+        REQUIRE(searchStats.maxDepth == 4);
+        REQUIRE(searchStats.resultsEmitted == (long)searchResults.size());
+
+        REQUIRE(reusedStats.maxDepth == 4);
+        REQUIRE(reusedStats.nodesVisited == 2 * searchStats.nodesVisited + 2 * fuzzyStats.nodesVisited);
+
+        REQUIRE(topKStats.nodesVisited > 0);
+        REQUIRE(topKStats.maxDepth == 4);
+#else
+        REQUIRE_FALSE(SearchStats::enabled());
+        REQUIRE(fuzzyStats.nodesVisited == 0);
+        REQUIRE(fuzzyStats.maxDepth == 0);
+        REQUIRE(searchStats.resultsEmitted == 0);
+#endif
+    }
+
+    SECTION("A memoized fuzzy search gives the same results as a fuzzy search"){
+        REQUIRE_NOTHROW(md->insert(singlySearchSeq3, doublySearchSeq3, searchString3));
+        REQUIRE_NOTHROW(md->insert(singlySearchSeq4, doublySearchSeq4, searchString4));
+        REQUIRE_NOTHROW(md->insert(singlySearchSeq2, doublySearchSeq2, searchString2));
+        REQUIRE_NOTHROW(md->finish());
+
+        for (int gaps = 0; gaps < 3; gaps++){
+            REQUIRE(md->memoizedFuzzySearch(singlySearchSeq2, gaps, 10) == md->fuzzySearch(singlySearchSeq2, gaps, 10));
+            REQUIRE(md->memoizedFuzzySearch(singlySearchSeq4, gaps, 10) == md->fuzzySearch(singlySearchSeq4, gaps, 10));
+            REQUIRE(md->memoizedFuzzySearch({700.7, 900.9}, gaps, 10) == md->fuzzySearch({700.7, 900.9}, gaps, 10));
+            REQUIRE(md->memoizedFuzzySearch(singlySearchSeq3.data(), 4, gaps, 10) == md->fuzzySearch(singlySearchSeq3, gaps, 10));
+        }
+
+        // every kmer reaches the shared 700.7, 900.9 suffix after two gaps with the same masses left
+        SearchStats fuzzyStats, memoStats;
+        vector<string> results = md->memoizedFuzzySearch({700.7, 900.9}, 2, 10, &memoStats);
+        md->fuzzySearch({700.7, 900.9}, 2, 10, &fuzzyStats);
+        REQUIRE(hasString(results, searchString2));
+        REQUIRE(hasString(results, searchString3));
+        REQUIRE(hasString(results, searchString4));
+
+#ifdef MASSDAWG_SEARCH_STATS
+        REQUIRE(memoStats.memoHits > 0);
+        REQUIRE(memoStats.nodesVisited < fuzzyStats.nodesVisited);
+#else
+        REQUIRE(memoStats.memoHits == 0);
+#endif
+    }
+
+    SECTION("A parallel insertion combines suffixes shared between shards"){
+        vector<vector<float> > singlySequences = {singlySearchSeq3, singlySearchSeq4, singlySearchSeq2};
+        vector<vector<float> > doublySequences = {doublySearchSeq3, doublySearchSeq4, doublySearchSeq2};
+        vector<string> kmers = {searchString3, searchString4, searchString2};
+        REQUIRE_NOTHROW(md->parallelInsert(singlySequences, doublySequences, kmers, 3));
+
+        vector<string> results = md->fuzzySearch(singlySearchSeq3, 0, 10);
+
+        REQUIRE(hasString(results, searchString3));
+        REQUIRE(hasString(results, searchString4));
+        REQUIRE(hasString(results, searchString2));
+    }
+
+    SECTION("A parallel insertion finds the same kmers as inserting one at a time"){
+        vector<vector<float> > singlySequences = {singlySearchSeq5, singlySearchSeq1, singlySearchSeq3, singlySearchSeq2, singlySearchSeq4};
+        vector<vector<float> > doublySequences = {doublySearchSeq5, doublySearchSeq1, doublySearchSeq3, doublySearchSeq2, doublySearchSeq4};
+        vector<string> kmers = {searchString5, searchString1, searchString3, searchString2, searchString4};
+        REQUIRE_NOTHROW(md->parallelInsert(singlySequences, doublySequences, kmers, 0));
+
+        MassDawg serial;
+        for (int i = 0; i < (int)kmers.size(); i++) serial.insert(singlySequences[i], doublySequences[i], kmers[i]);
+        serial.finish();
+
+        for (int gap = 0; gap < 3; gap++){
+            for (const vector<float> & sequence: singlySequences){
+                vector<string> parallelResults = md->fuzzySearch(sequence, gap, 10);
+                vector<string> serialResults = serial.fuzzySearch(sequence, gap, 10);
+                // compare the kmers found, not how many paths found them
+                sort(parallelResults.begin(), parallelResults.end());
+                sort(serialResults.begin(), serialResults.end());
+                parallelResults.erase(unique(parallelResults.begin(), parallelResults.end()), parallelResults.end());
+                serialResults.erase(unique(serialResults.begin(), serialResults.end()), serialResults.end());
+
+                REQUIRE(parallelResults == serialResults);
+            }
+        }
+    }
+
+    SECTION("Inserting into a finished graph gives the same graph as inserting everything before finishing"){
+        // MNXY shares its last two nodes with WXYZ, so they are merged away by finish
+        vector<float> singlyExtended = singlySearchSeq4, doublyExtended = doublySearchSeq4;
+        singlyExtended.push_back(1000.1);
+        doublyExtended.push_back(500.05);
+
+        md->insert(singlySearchSeq3, doublySearchSeq3, searchString3);
+        md->insert(singlySearchSeq4, doublySearchSeq4, searchString4);
+        md->finish();
+        REQUIRE_NOTHROW(md->insert(singlyExtended, doublyExtended, "MNXYQ"));
+        REQUIRE_NOTHROW(md->insert(singlySearchSeq1, doublySearchSeq1, searchString1));
+        md->finish();
+        REQUIRE_NOTHROW(md->insert(singlySearchSeq2, doublySearchSeq2, searchString2));
+        md->finish();
+
+        MassDawg rebuilt;
+        rebuilt.insert(singlySearchSeq3, doublySearchSeq3, searchString3);
+        rebuilt.insert(singlySearchSeq4, doublySearchSeq4, searchString4);
+        rebuilt.insert(singlyExtended, doublyExtended, "MNXYQ");
+        rebuilt.insert(singlySearchSeq1, doublySearchSeq1, searchString1);
+        rebuilt.insert(singlySearchSeq2, doublySearchSeq2, searchString2);
+        rebuilt.finish();
+
+        REQUIRE(md->stats().nodes == rebuilt.stats().nodes);
+        REQUIRE(md->stats().edges == rebuilt.stats().edges);
+        REQUIRE(hasString(md->search(singlyExtended, 10), "MNXYQ"));
+        for (const vector<float> & sequence: {singlyExtended, singlySearchSeq1, singlySearchSeq2, singlySearchSeq3}){
+            REQUIRE(md->fuzzySearch(sequence, 1, 10) == rebuilt.fuzzySearch(sequence, 1, 10));
+        }
+    }
+
+    SECTION("Inserting after a parallel insertion does not add a second edge with the same masses"){
+        REQUIRE_NOTHROW(md->parallelInsert({singlySearchSeq1, singlySearchSeq3}, {doublySearchSeq1, doublySearchSeq3}, {searchString1, searchString3}, 2));
+        REQUIRE_NOTHROW(md->insert(singlySearchSeq2, doublySearchSeq2, searchString2));
+        md->finish();
+
+        MassDawg rebuilt;
+        rebuilt.insert(singlySearchSeq3, doublySearchSeq3, searchString3);
+        rebuilt.insert(singlySearchSeq1, doublySearchSeq1, searchString1);
+        rebuilt.insert(singlySearchSeq2, doublySearchSeq2, searchString2);
+        rebuilt.finish();
+
+        REQUIRE(md->stats().edges == rebuilt.stats().edges);
+        REQUIRE(md->search(singlySearchSeq2, 10) == rebuilt.search(singlySearchSeq2, 10));
+    }
+
+    SECTION("Removing a kmer gives the same graph as never inserting it"){
+        md->insert(singlySearchSeq1, doublySearchSeq1, searchString1);
+        md->insert(singlySearchSeq2, doublySearchSeq2, searchString2);
+        md->insert(singlySearchSeq3, doublySearchSeq3, searchString3);
+        md->insert(singlySearchSeq4, doublySearchSeq4, searchString4);
+        md->finish();
+
+        // ABYZ shares its prefix with ABCD and its suffix with WXYZ and MNXY
+        REQUIRE(md->remove(singlySearchSeq2, doublySearchSeq2, searchString2));
+
+        MassDawg rebuilt;
+        rebuilt.insert(singlySearchSeq1, doublySearchSeq1, searchString1);
+        rebuilt.insert(singlySearchSeq3, doublySearchSeq3, searchString3);
+        rebuilt.insert(singlySearchSeq4, doublySearchSeq4, searchString4);
+        rebuilt.finish();
+
+        REQUIRE(md->stats().nodes == rebuilt.stats().nodes);
+        REQUIRE(md->stats().edges == rebuilt.stats().edges);
+        REQUIRE(md->stats().kmers == rebuilt.stats().kmers);
+        REQUIRE_FALSE(hasString(md->search(singlySearchSeq2, 10), searchString2));
+        REQUIRE_FALSE(hasString(md->fuzzySearch(singlySearchSeq2, 1, 10), "ABY"));
+        for (const vector<float> & sequence: {singlySearchSeq1, singlySearchSeq2, singlySearchSeq3, singlySearchSeq4}){
+            REQUIRE(md->fuzzySearch(sequence, 1, 10) == rebuilt.fuzzySearch(sequence, 1, 10));
+        }
+    }
+
+    SECTION("A kmer inserted twice stays in the graph until it is removed twice"){
+        md->insert(singlySearchSeq1, doublySearchSeq1, searchString1);
+        md->insert(singlySearchSeq1, doublySearchSeq1, searchString1);
+        md->finish();
+        REQUIRE(md->insertionCount(searchString1) == 2);
+        // prefixes are held by nodes but were not inserted
+        REQUIRE(md->insertionCount("ABC") == 0);
+        REQUIRE(md->insertionCount(searchString2) == 0);
+
+        REQUIRE(md->remove(singlySearchSeq1, doublySearchSeq1, searchString1));
+        REQUIRE(hasString(md->search(singlySearchSeq1, 10), searchString1));
+        REQUIRE(md->insertionCount(searchString1) == 1);
+
+        REQUIRE(md->remove(singlySearchSeq1, doublySearchSeq1, searchString1));
+        REQUIRE(md->search(singlySearchSeq1, 10).empty());
+        REQUIRE(md->insertionCount(searchString1) == 0);
+        REQUIRE(md->stats().nodes == 1);
+        REQUIRE(md->stats().edges == 0);
+
+        REQUIRE_FALSE(md->remove(singlySearchSeq1, doublySearchSeq1, searchString1));
+    }
+
+    SECTION("Removing a kmer that was not inserted with those masses leaves the graph as it was"){
+        md->insert(singlySearchSeq1, doublySearchSeq1, searchString1);
+        md->insert(singlySearchSeq3, doublySearchSeq3, searchString3);
+        md->finish();
+        MassDawgStats before = md->stats();
+
+        // a prefix of an inserted kmer, a kmer never inserted and an inserted kmer with other masses
+        REQUIRE_FALSE(md->remove({200.2, 400.4}, {100.1, 200.2}, "AB"));
+        REQUIRE_FALSE(md->remove(singlySearchSeq2, doublySearchSeq2, searchString2));
+        REQUIRE_FALSE(md->remove(singlySearchSeq3, doublySearchSeq3, searchString1));
+        REQUIRE_THROWS_AS(md->remove(singlySearchSeq1, doublySearchSeq2, "ABC"), invalid_argument);
+
+        REQUIRE(md->stats().nodes == before.nodes);
+        REQUIRE(md->stats().edges == before.edges);
+        REQUIRE(hasString(md->search(singlySearchSeq1, 10), searchString1));
+        REQUIRE(hasString(md->search(singlySearchSeq3, 10), searchString3));
+    }
+
+    SECTION("Kmers can be removed before finishing and inserted again afterwards"){
+        md->insert(singlySearchSeq3, doublySearchSeq3, searchString3);
+        md->insert(singlySearchSeq4, doublySearchSeq4, searchString4);
+        REQUIRE(md->remove(singlySearchSeq4, doublySearchSeq4, searchString4));
+        REQUIRE_FALSE(hasString(md->search(singlySearchSeq4, 10), searchString4));
+        REQUIRE(hasString(md->search(singlySearchSeq3, 10), searchString3));
+
+        md->insert(singlySearchSeq4, doublySearchSeq4, searchString4);
+        md->finish();
+        REQUIRE(hasString(md->search(singlySearchSeq4, 10), searchString4));
+        REQUIRE(md->stats().nodes == 7);
+    }
+
+    SECTION("Kmers of a parallel insertion can be removed"){
+        md->parallelInsert({singlySearchSeq1, singlySearchSeq2, singlySearchSeq3}, {doublySearchSeq1, doublySearchSeq2, doublySearchSeq3}, 
+            {searchString1, searchString2, searchString3}, 2);
+
+        REQUIRE(md->remove(singlySearchSeq3, doublySearchSeq3, searchString3));
+        REQUIRE(md->remove(singlySearchSeq2, doublySearchSeq2, searchString2));
+
+        MassDawg rebuilt;
+        rebuilt.insert(singlySearchSeq1, doublySearchSeq1, searchString1);
+        rebuilt.finish();
+        REQUIRE(md->stats().nodes == rebuilt.stats().nodes);
+        REQUIRE(md->stats().edges == rebuilt.stats().edges);
+    }
+
+    SECTION("A parallel insertion with a different number of masses and kmers throws an error"){
+        vector<vector<float> > singlySequences = {singlySearchSeq1, singlySearchSeq2};
+        vector<vector<float> > doublySequences = {doublySearchSeq1};
+        vector<string> kmers = {searchString1, searchString2};
+
+        REQUIRE_THROWS_AS(md->parallelInsert(singlySequences, doublySequences, kmers, 2), invalid_argument);
+    }
+}
@@ -5,8 +5,6 @@ TEST_CASE("Mass Dawg Node test cases"){
     MassDawgNode * mdn;
     MassDawgNode * child;
 
-    float delta = 0.0001;
-
     SECTION("Initiating a Mass Dawg Node with no kmers gives a node with no kmers or children"){
         mdn = new MassDawgNode();
 
@@ -14,26 +12,26 @@ TEST_CASE("Mass Dawg Node test cases"){
         REQUIRE(mdn->children.size() == 0);
     }
 
-    mdn = new MassDawgNode(100.1, 200.2, "ABC");
+    mdn = new MassDawgNode(nodeMasses(toFixedMass(100.1), toFixedMass(200.2)), 0);
     SECTION("Creating a Mass Dawg Node with a kmer and 2 masses gives a node with a single kmer, 2 masses and no childre"){
 
         REQUIRE(mdn->kmers.size() == 1);
-        REQUIRE(mdn->kmers[0] == "ABC");
-        REQUIRE((double)abs(mdn->singlyMass - 100.1) < delta);
-        REQUIRE((double)abs(mdn->doublyMass - 200.2) < delta);
+        REQUIRE(mdn->kmers[0] == 0);
+        REQUIRE(mdn->masses[0] == toFixedMass(100.1));
+        REQUIRE(mdn->masses == nodeMasses(toFixedMass(100.1), toFixedMass(200.2)));
 
         REQUIRE(mdn->children.size() == 0);
     }
 
-    mdn->addKmer("DEF");
+    mdn->addKmer(1);
     SECTION("Adding a kmer to an existing node increases the size of the kmers vector and adds the kmer"){
 
         REQUIRE(mdn->kmers.size() == 2);
-        REQUIRE(mdn->kmers[1] == "DEF");
-        REQUIRE(mdn->kmers[0] == "ABC");
+        REQUIRE(mdn->kmers[1] == 1);
+        REQUIRE(mdn->kmers[0] == 0);
     }
 
-    child = mdn->addChild(300.3, 400.4, "XYZ");
+    child = mdn->addChild(nodeMasses(toFixedMass(300.3), toFixedMass(400.4)), 2);
     SECTION("Adding a child to the node returns a child with the 2 masses and kmer passed in"){
 
         REQUIRE(mdn->children.size() == 1);
@@ -41,9 +39,9 @@ TEST_CASE("Mass Dawg Node test cases"){
 
         REQUIRE(child->kmers.size() == 1);
         REQUIRE(child->children.size() == 0);
-        REQUIRE((double)abs(child->singlyMass - 300.3) < delta);
-        REQUIRE((double)abs(child->doublyMass - 400.4) < delta);
-        REQUIRE(child->kmers[0] == "XYZ");
+        REQUIRE(child->masses[0] == toFixedMass(300.3));
+        REQUIRE(child->masses == nodeMasses(toFixedMass(300.3), toFixedMass(400.4)));
+        REQUIRE(child->kmers[0] == 2);
     }
 
     SECTION("Hashing of nodes return different values for nodes with different masses"){
@@ -55,11 +53,11 @@ TEST_CASE("Mass Dawg Node test cases"){
 
     delete mdn;
     delete child;
-    mdn = new MassDawgNode(100.1, 200.2, "ABC");
-    child = new MassDawgNode(300.3, 400.4, "XYZ");
+    mdn = new MassDawgNode(nodeMasses(toFixedMass(100.1), toFixedMass(200.2)), 0);
+    child = new MassDawgNode(nodeMasses(toFixedMass(300.3), toFixedMass(400.4)), 2);
     SECTION("Adding child by pointer does not throw an error and child can be found"){
         REQUIRE_NOTHROW(mdn->addChildByPointer(child));
-        REQUIRE(mdn->children[0]->kmers[0] == "XYZ");
+        REQUIRE(mdn->children[0]->kmers[0] == 2);
     }
 
     SECTION("Adding a child by pointer then trying to add it again will not add it the second time"){
@@ -68,12 +66,106 @@ TEST_CASE("Mass Dawg Node test cases"){
         REQUIRE(mdn->children.size() == 1);
     }
 
-    SECTION("Adding a child by pointer then adding another one with masses within the delta of .001 will not add the second child"){
+    SECTION("Adding a child by pointer then adding another one with the same masses will not add the second child"){
         REQUIRE_NOTHROW(mdn->addChildByPointer(child));
         
-        MassDawgNode * otherChild = new MassDawgNode(300.3001, 400.4001, "XYZ");
+        MassDawgNode * otherChild = new MassDawgNode(nodeMasses(toFixedMass(300.3), toFixedMass(400.4)), 2);
         REQUIRE_NOTHROW(mdn->addChildByPointer(otherChild));
         REQUIRE(mdn->children.size() == 1);
+        delete otherChild;
+    }
+
+    SECTION("Adding a child by pointer then adding another one 1 unit of mass away adds the second child"){
+        REQUIRE_NOTHROW(mdn->addChildByPointer(child));
+        
+        MassDawgNode * otherChild = new MassDawgNode(nodeMasses(toFixedMass(300.3) + 1, toFixedMass(400.4)), 2);
+        REQUIRE_NOTHROW(mdn->addChildByPointer(otherChild));
+        REQUIRE(mdn->children.size() == 2);
+        delete otherChild;
+    }
+
+    SECTION("Children added out of order are kept sorted by their masses"){
+        MassDawgNode * third = mdn->addChild(nodeMasses(toFixedMass(500.5), toFixedMass(250.25)), 3);
+        MassDawgNode * first = mdn->addChild(nodeMasses(toFixedMass(100.1), toFixedMass(50.05)), 4);
+        MassDawgNode * second = new MassDawgNode(nodeMasses(toFixedMass(300.3), toFixedMass(150.15)), 5);
+        mdn->addChildByPointer(second);
+
+        REQUIRE(mdn->children.size() == 3);
+        REQUIRE(mdn->children[0] == first);
+        REQUIRE(mdn->children[1] == second);
+        REQUIRE(mdn->children[2] == third);
+
+        delete first;
+        delete second;
+        delete third;
+    }
+
+    SECTION("Finding a child by its masses finds it only when every mass is the same"){
+        mdn->addChildByPointer(child);
+
+        REQUIRE(mdn->findChild(nodeMasses(toFixedMass(300.3), toFixedMass(400.4))) == child);
+        REQUIRE(mdn->findChild(nodeMasses(toFixedMass(300.3) + 1, toFixedMass(400.4))) == nullptr);
+        REQUIRE(mdn->findChild(nodeMasses(toFixedMass(300.31), toFixedMass(400.4))) == nullptr);
+        REQUIRE(mdn->findChild(nodeMasses(toFixedMass(100.1), toFixedMass(200.2))) == nullptr);
+
+        // only builds that keep the doubly mass can tell these apart
+#if MASSDAWG_CHARGES > 1
+        MassDawgNode * other = mdn->addChild(nodeMasses(toFixedMass(300.3), toFixedMass(500.5)), 6);
+
+        REQUIRE(mdn->findChild(nodeMasses(toFixedMass(300.3), toFixedMass(400.4) - 1)) == nullptr);
+        REQUIRE(mdn->findChild(nodeMasses(toFixedMass(300.3), toFixedMass(500.5))) == other);
+
+        delete other;
+#endif
+    }
+
+    SECTION("Kmers and edges added again are counted and only dropped when every count is removed"){
+        REQUIRE(mdn->kmerCounts.empty());
+        mdn->addKmer(1);
+        mdn->addKmer(1);
+        mdn->addChildByPointer(child);
+        mdn->linkChild(child, 2);
+
+        REQUIRE(mdn->kmers.size() == 2);
+        REQUIRE(mdn->kmerCount(1) == 2);
+        REQUIRE(mdn->children.size() == 1);
+        REQUIRE(mdn->childCountAt(0) == 3);
+
+        REQUIRE(mdn->removeKmer(1));
+        REQUIRE(mdn->kmerCount(1) == 1);
+        REQUIRE(mdn->removeKmer(1));
+        REQUIRE(mdn->kmers == vector<uint32_t> {0});
+        REQUIRE_FALSE(mdn->removeKmer(1));
+
+        REQUIRE(mdn->unlinkChild(child));
+        REQUIRE(mdn->unlinkChild(child));
+        REQUIRE(mdn->children.size() == 1);
+        REQUIRE(mdn->unlinkChild(child));
+        REQUIRE(mdn->children.empty());
+        REQUIRE_FALSE(mdn->unlinkChild(child));
+    }
+
+    SECTION("Masses of charges above 2 are computed from the singly mass"){
+        ChargeMasses<3> masses = chargeMasses<3>(toFixedMass(301.0), toFixedMass(151.0));
+
+        REQUIRE(masses[0] == toFixedMass(301.0));
+        REQUIRE(masses[1] == toFixedMass(151.0));
+        REQUIRE(masses[2] == toFixedMass((301.0 + 2 * PROTON_MASS) / 3));
+
+        ChargeMasses<1> singly = chargeMasses<1>(toFixedMass(301.0), toFixedMass(151.0));
+        REQUIRE(singly[0] == toFixedMass(301.0));
+        REQUIRE(sizeof(singly) == sizeof(FixedMass));
+    }
+
+    SECTION("Windows are computed around the mass of every charge"){
+        ChargeWindows<3> windows = massWindows(chargeMasses<3>(1000000, 500000), 10);
+
+        REQUIRE(windows.lower[0] == 999990);
+        REQUIRE(windows.upper[0] == 1000010);
+        REQUIRE(windows.lower[1] == 499995);
+        REQUIRE(windows.upper[1] == 500005);
+        REQUIRE(windows.lower[2] < windows.upper[2]);
+        REQUIRE(windows.upper[2] < windows.lower[1]);
     }
 
     delete mdn;
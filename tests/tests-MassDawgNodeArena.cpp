@@ -0,0 +1,47 @@
+#include <vector>
+
+#include "catch.hpp"
+#include "../src/MassDawgNodeArena.hpp"
+
+using namespace std;
+
+TEST_CASE("Mass Dawg Node Arena test cases"){
+    MassDawgNodeArena * arena = new MassDawgNodeArena(4);
+
+    SECTION("Allocating a node from the arena gives a node with the masses and kmer passed in"){
+        MassDawgNode * node = arena->allocate(nodeMasses(toFixedMass(100.1), toFixedMass(200.2)), 0);
+
+        REQUIRE(node->kmers.size() == 1);
+        REQUIRE(node->kmers[0] == 0);
+        REQUIRE(node->children.size() == 0);
+        REQUIRE(node->masses == nodeMasses(toFixedMass(100.1), toFixedMass(200.2)));
+        REQUIRE(arena->liveNodes() == 1);
+    }
+
+    SECTION("Allocating more nodes than fit in a slab gives distinct nodes"){
+        vector<MassDawgNode *> nodes;
+        for (int i = 0; i < 10; i++) nodes.push_back(arena->allocate(nodeMasses(i, i), 0));
+
+        for (int i = 0; i < 10; i++){
+            for (int j = i + 1; j < 10; j++) REQUIRE(nodes[i] != nodes[j]);
+            REQUIRE(nodes[i]->masses[0] == i);
+        }
+        REQUIRE(arena->liveNodes() == 10);
+    }
+
+    SECTION("A released node is cleared and reused by the next allocation"){
+        MassDawgNode * node = arena->allocate(nodeMasses(toFixedMass(100.1), toFixedMass(200.2)), 0);
+        node->addChild(nodeMasses(toFixedMass(300.3), toFixedMass(400.4)), 1, arena);
+        REQUIRE(arena->liveNodes() == 2);
+
+        arena->release(node);
+        REQUIRE(arena->liveNodes() == 1);
+
+        MassDawgNode * reused = arena->allocate();
+        REQUIRE(reused == node);
+        REQUIRE(reused->kmers.size() == 0);
+        REQUIRE(reused->children.size() == 0);
+    }
+
+    delete arena;
+}
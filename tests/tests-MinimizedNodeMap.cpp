@@ -0,0 +1,76 @@
+#include <vector>
+
+#include "catch.hpp"
+#include "../src/MinimizedNodeMap.hpp"
+
+using namespace std;
+
+TEST_CASE("Minimized Node Map test cases"){
+    MinimizedNodeMap * map = new MinimizedNodeMap();
+    MassDawgNode * node = new MassDawgNode(nodeMasses(toFixedMass(100.1), toFixedMass(200.2)), 0);
+    MassDawgNode * other = new MassDawgNode(nodeMasses(toFixedMass(300.3), toFixedMass(400.4)), 1);
+
+    SECTION("Looking up masses that were never inserted gives null"){
+        REQUIRE(map->find(node->masses) == nullptr);
+        REQUIRE(map->size() == 0);
+    }
+
+    SECTION("Inserted nodes can be found by their masses"){
+        map->insert(node);
+        map->insert(other);
+
+        REQUIRE(map->find(node->masses) == node);
+        REQUIRE(map->find(other->masses) == other);
+        REQUIRE(map->size() == 2);
+    }
+
+    SECTION("Nodes with the same masses have the same key"){
+        MassDawgNode * same = new MassDawgNode(nodeMasses(toFixedMass(100.1), toFixedMass(200.2)), 2);
+        map->insert(node);
+
+        REQUIRE(same->hash() == node->hash());
+        REQUIRE(map->find(same->masses) == node);
+
+        delete same;
+    }
+
+    SECTION("The map keeps every node when it grows"){
+        vector<MassDawgNode *> nodes;
+        for (int i = 0; i < 5000; i++){
+            nodes.push_back(new MassDawgNode(nodeMasses(toFixedMass(i + .5), toFixedMass(i * 2 + .25)), i));
+            map->insert(nodes.back());
+        }
+
+        REQUIRE(map->size() == 5000);
+        for (MassDawgNode * n: nodes){
+            REQUIRE(map->find(n->masses) == n);
+            delete n;
+        }
+    }
+
+    SECTION("Removed nodes are not found and every other node still is"){
+        vector<MassDawgNode *> nodes;
+        for (int i = 0; i < 2000; i++){
+            nodes.push_back(new MassDawgNode(nodeMasses(toFixedMass(i + .5), toFixedMass(i * 2 + .25)), i));
+            map->insert(nodes.back());
+        }
+
+        // removing a node with the same masses as a registered one does nothing
+        MassDawgNode * same = new MassDawgNode(nodes[0]->masses, 0);
+        map->remove(same);
+        REQUIRE(map->find(same->masses) == nodes[0]);
+        delete same;
+
+        for (int i = 0; i < 2000; i += 3) map->remove(nodes[i]);
+
+        REQUIRE(map->size() == 2000 - 667);
+        for (int i = 0; i < 2000; i++){
+            REQUIRE(map->find(nodes[i]->masses) == (i % 3 == 0 ? nullptr : nodes[i]));
+            delete nodes[i];
+        }
+    }
+
+    delete map;
+    delete node;
+    delete other;
+}
@@ -0,0 +1,88 @@
+#include <vector>
+#include <random>
+#include <algorithm>
+
+#include "catch.hpp"
+#include "../src/WindowKernel.hpp"
+
+using namespace std;
+
+TEST_CASE("Window kernel test cases"){
+    mt19937 rng(42);
+    uniform_int_distribution<FixedMass> mass(50 * FIXED_MASS_SCALE, 3000 * FIXED_MASS_SCALE);
+
+    SECTION("Counting below a bound gives the index lower_bound gives"){
+        for (int length: {0, 1, 3, 4, 7, 8, 9, 16, 31, 100, 256, 257, 1000}){
+            vector<FixedMass> sorted;
+            for (int i = 0; i < length; i++) sorted.push_back(mass(rng));
+            sort(sorted.begin(), sorted.end());
+
+            // the signed compares have to hold at the ends of the range too
+            vector<FixedMass> bounds = {0, INT32_MIN, INT32_MAX};
+            for (FixedMass m: sorted) bounds.insert(bounds.end(), {m, m - 1, m + 1});
+
+            for (FixedMass bound: bounds){
+                int expected = (int)(lower_bound(sorted.begin(), sorted.end(), bound) - sorted.begin());
+                REQUIRE(countBelow(sorted.data(), length, bound) == expected);
+                REQUIRE(countBelowScalar(sorted.data(), length, bound) == expected);
+            }
+        }
+    }
+
+    SECTION("Finding a window gives the range lower_bound and upper_bound give, on every path"){
+        for (int length: {0, 1, 3, 4, 7, 8, 9, 16, 31, 100, 257}){
+            vector<FixedMass> sorted;
+            for (int i = 0; i < length; i++) sorted.push_back(mass(rng));
+            // repeated masses can straddle the ends of a window and the blocks
+            if (length > 4) sorted.insert(sorted.end(), 6, sorted[length / 2]);
+            sort(sorted.begin(), sorted.end());
+            int size = (int)sorted.size();
+
+            vector<FixedMass> lowers = {0, INT32_MIN};
+            for (FixedMass m: sorted) lowers.insert(lowers.end(), {m, m - 1, m + 1});
+
+            for (FixedMass lowerBound: lowers){
+                // windows as wide as a peak or two, and an empty one
+                for (int64_t width: {(int64_t)-1, (int64_t)0, (int64_t)20, (int64_t)FIXED_MASS_SCALE, (int64_t)100 * FIXED_MASS_SCALE}){
+                    FixedMass upperBound = (FixedMass)min((int64_t)INT32_MAX, (int64_t)lowerBound + width);
+
+                    int start = (int)(lower_bound(sorted.begin(), sorted.end(), lowerBound) - sorted.begin());
+                    int end = upperBound < lowerBound ? start : (int)(upper_bound(sorted.begin(), sorted.end(), upperBound) - sorted.begin());
+
+                    WindowMatches matches = findWindow(sorted.data(), size, lowerBound, upperBound);
+                    REQUIRE(matches.start == start);
+                    REQUIRE(matches.end == end);
+                    if (upperBound < lowerBound) continue;
+
+                    matches = findWindowScalar(sorted.data(), size, lowerBound, upperBound);
+                    REQUIRE((matches.start == start && matches.end == end));
+#ifdef WINDOW_KERNEL_X86
+                    matches = findWindowSse2(sorted.data(), size, lowerBound, upperBound);
+                    REQUIRE((matches.start == start && matches.end == end));
+                    if (windowKernelHasAvx2()){
+                        matches = findWindowAvx2(sorted.data(), size, lowerBound, upperBound);
+                        REQUIRE((matches.start == start && matches.end == end));
+                    }
+#endif
+                }
+            }
+        }
+    }
+
+#ifdef WINDOW_KERNEL_X86
+    SECTION("Every vector path counts the same as the scalar one, repeated masses included"){
+        vector<FixedMass> sorted;
+        for (int i = 0; i < 40; i++) sorted.push_back(mass(rng));
+        sorted.insert(sorted.end(), 10, sorted[0]);
+        sort(sorted.begin(), sorted.end());
+
+        for (int length = 0; length <= (int)sorted.size(); length++){
+            for (FixedMass bound: sorted){
+                int expected = countBelowScalar(sorted.data(), length, bound);
+                REQUIRE(countBelowSse2(sorted.data(), length, bound) == expected);
+                if (windowKernelHasAvx2()) REQUIRE(countBelowAvx2(sorted.data(), length, bound) == expected);
+            }
+        }
+    }
+#endif
+}